@@ -0,0 +1,435 @@
+//**************************************************************************************
+//								< Access Trace >
+//**************************************************************************************
+// Type:		Benchmark utility
+// Purpose:		Trace-driven comparison of SplayBST, OptimalBST and RedBlackBST,
+//				of SplayCache with an LRU hash map, and of LinkCutTree with BFS
+// Name:		Access trace
+// Implementation details:
+//		> Traces are plain key sequences over the keys [0, n): recorded ones can
+//		  be replayed as they are, synthetic ones come from the generators below.
+//		> Replay runs the trace twice. The first pass is timed only, the second one
+//		  reads Depth() and Rotations() around every lookup.
+//		> Search depth = depth of the found node after the lookup + rotations done
+//		  by the lookup. Exact for SplayBST and RedBlackBST, an upper bound for
+//		  OptimalBST, whose rotations do not always lift the found node.
+//		> Restructuring writes are counted in rotations (constant pointer writes each).
+//		> ReplayCache treats a cache as read-through: a miss inserts the key.
+//		> DynamicForest traces change a forest and query it. ReplayForest runs them
+//		  on a link-cut tree, ReplayForestBfs answers every query by BFS over
+//		  adjacency lists. Equal checksums mean equal answers.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <list>
+#include <queue>
+#include <utility>
+#include <unordered_map>
+
+namespace AccessTrace
+{
+	struct Stats
+	{
+		double nsPerLookup			= 0;
+		double averageDepth			= 0;
+		double rotationsPerLookup	= 0;
+		size_t misses				= 0;
+	};
+
+	struct CacheStats
+	{
+		double nsPerAccess	= 0;
+		double hitRate		= 0;
+	};
+
+	struct ForestStats
+	{
+		double nsPerOperation			= 0;
+		unsigned long long checksum		= 0;
+	};
+
+	struct ForestOperation
+	{
+		enum Kind { Relink, Connected, PathLength };
+
+		Kind kind;
+		unsigned int first;
+		unsigned int second;
+	};
+
+	struct ForestTrace
+	{
+		std::vector<unsigned int> parents;		// the initial tree, a root is its own parent
+		std::vector<ForestOperation> operations;
+	};
+
+	// Reference LRU cache: a hash map into a recency list, most recent first.
+	template<typename K, typename T>
+	class LruCache
+	{
+	private:
+		typedef std::list<std::pair<K, T>> List;
+		List entries;
+		std::unordered_map<K, typename List::iterator> index;
+		size_t capacity;
+
+	public:
+		explicit LruCache(size_t _capacity)
+			: capacity{ _capacity }
+		{
+		}
+
+	public:
+		T* Find(const K& key)
+		{
+			auto found = index.find(key);
+			if (found == index.end()) {
+				return nullptr;
+			}
+			entries.splice(entries.begin(), entries, found->second);
+			return &found->second->second;
+		}
+		void Insert(const K& key, const T& data)
+		{
+			if (T* cached = Find(key))
+			{
+				*cached = data;
+				return;
+			}
+			if (entries.size() == capacity)
+			{
+				index.erase(entries.back().first);
+				entries.pop_back();
+			}
+			entries.emplace_front(key, data);
+			index.emplace(key, entries.begin());
+		}
+	};
+
+	// Zipf distributed keys: rank r is drawn with probability ~ 1 / r^skew,
+	// ranks are mapped to keys through a random permutation.
+	inline std::vector<unsigned int> Zipf(unsigned int n, size_t length, double skew, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		std::vector<double> cdf(n);
+		double sum = 0;
+		for (unsigned int rank = 0; rank < n; rank++)
+		{
+			sum += 1.0 / std::pow(rank + 1.0, skew);
+			cdf[rank] = sum;
+		}
+		std::vector<unsigned int> keys(n);
+		std::iota(keys.begin(), keys.end(), 0);
+		std::shuffle(keys.begin(), keys.end(), random);
+
+		std::uniform_real_distribution<double> uniform(0, sum);
+		std::vector<unsigned int> trace(length);
+		for (auto& key : trace)
+		{
+			auto rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin();
+			key = keys[std::min<size_t>(rank, n - 1)];
+		}
+		return trace;
+	}
+
+	// Uniform accesses inside a window of setSize keys that jumps every phaseLength accesses.
+	inline std::vector<unsigned int> WorkingSetShift(unsigned int n, size_t length, unsigned int setSize,
+		size_t phaseLength, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		setSize = std::min(std::max(setSize, 1u), n);
+		std::uniform_int_distribution<unsigned int> start(0, n - setSize);
+		std::uniform_int_distribution<unsigned int> offset(0, setSize - 1);
+
+		std::vector<unsigned int> trace(length);
+		unsigned int base = start(random);
+		for (size_t i = 0; i < length; i++)
+		{
+			if (phaseLength && i && i % phaseLength == 0) {
+				base = start(random);
+			}
+			trace[i] = base + offset(random);
+		}
+		return trace;
+	}
+
+	// Repeated in-order scans over all keys.
+	inline std::vector<unsigned int> SequentialScan(unsigned int n, size_t length)
+	{
+		std::vector<unsigned int> trace(length);
+		for (size_t i = 0; i < length; i++) {
+			trace[i] = static_cast<unsigned int>(i % n);
+		}
+		return trace;
+	}
+
+	// Random walk over the key space: every access lies within maxStep of the previous one.
+	inline std::vector<unsigned int> DynamicFinger(unsigned int n, size_t length, unsigned int maxStep, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<int> step(-static_cast<int>(maxStep), static_cast<int>(maxStep));
+
+		std::vector<unsigned int> trace(length);
+		long long key = n / 2;
+		for (auto& access : trace)
+		{
+			key = std::min<long long>(std::max<long long>(key + step(random), 0), n - 1);
+			access = static_cast<unsigned int>(key);
+		}
+		return trace;
+	}
+
+	// Random recursive tree over n >= 2 nodes rooted at 0, then relinkPercent% relinks,
+	// the other operations split between connectivity and path length queries.
+	// A relink cuts first off its parent, if it has one, and hangs it under second
+	// unless second lies in first's own tree: then first stays a root.
+	inline ForestTrace DynamicForest(unsigned int n, size_t length, unsigned int relinkPercent = 10, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		ForestTrace trace;
+		trace.parents.resize(n, 0);
+		for (unsigned int node = 1; node < n; node++) {
+			trace.parents[node] = std::uniform_int_distribution<unsigned int>(0, node - 1)(random);
+		}
+
+		std::uniform_int_distribution<unsigned int> percent(0, 99);
+		std::uniform_int_distribution<unsigned int> node(0, n - 1);
+		trace.operations.resize(length);
+		for (auto& operation : trace.operations)
+		{
+			unsigned int roll = percent(random);
+			if (roll < relinkPercent) {
+				operation.kind = ForestOperation::Relink;
+			}
+			else {
+				operation.kind = roll % 2 ? ForestOperation::Connected : ForestOperation::PathLength;
+			}
+			operation.first = node(random);
+			operation.second = node(random);
+		}
+		return trace;
+	}
+
+	// Replays trace against a forest of trace.parents.size() nodes valued 1, exposing
+	// Link(child, parent), Cut(first, second), Connected(first, second) and
+	// PathAggregate(first, second) summing the values, e.g. LinkCutTree<unsigned long long>.
+	template<typename Forest>
+	ForestStats ReplayForest(Forest& forest, const ForestTrace& trace)
+	{
+		std::vector<unsigned int> parents = trace.parents;
+		for (unsigned int node = 0; node < parents.size(); node++)
+		{
+			if (parents[node] != node) {
+				forest.Link(node, parents[node]);
+			}
+		}
+
+		ForestStats stats;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& operation : trace.operations)
+		{
+			unsigned int first = operation.first;
+			unsigned int second = operation.second;
+			if (operation.kind == ForestOperation::Relink)
+			{
+				if (parents[first] != first)
+				{
+					forest.Cut(first, parents[first]);
+					parents[first] = first;
+				}
+				if (!forest.Connected(first, second))
+				{
+					forest.Link(first, second);
+					parents[first] = second;
+				}
+			}
+			else if (forest.Connected(first, second)) {
+				stats.checksum += operation.kind == ForestOperation::Connected ? 1 : forest.PathAggregate(first, second);
+			}
+		}
+		auto finish = std::chrono::steady_clock::now();
+		if (!trace.operations.empty()) {
+			stats.nsPerOperation =
+				std::chrono::duration<double, std::nano>(finish - start).count() / trace.operations.size();
+		}
+		return stats;
+	}
+
+	// Replays trace recomputing every answer by BFS, the baseline for ReplayForest.
+	inline ForestStats ReplayForestBfs(const ForestTrace& trace)
+	{
+		std::vector<unsigned int> parents = trace.parents;
+		std::vector<std::vector<unsigned int>> adjacent(parents.size());
+		for (unsigned int node = 0; node < parents.size(); node++)
+		{
+			if (parents[node] != node)
+			{
+				adjacent[node].push_back(parents[node]);
+				adjacent[parents[node]].push_back(node);
+			}
+		}
+		auto unlink = [&](unsigned int from, unsigned int to)
+		{
+			auto& edges = adjacent[from];
+			*std::find(edges.begin(), edges.end(), to) = edges.back();
+			edges.pop_back();
+		};
+		// nodes on the path from first to second, 0 if they are not connected
+		std::vector<unsigned int> previous(parents.size());
+		std::vector<size_t> visited(parents.size(), 0);
+		size_t round = 0;
+		auto path = [&](unsigned int first, unsigned int second) -> unsigned long long
+		{
+			round++;
+			std::queue<unsigned int> pending;
+			pending.push(first);
+			visited[first] = round;
+			previous[first] = first;
+			while (!pending.empty() && visited[second] != round)
+			{
+				unsigned int node = pending.front();
+				pending.pop();
+				for (unsigned int next : adjacent[node])
+				{
+					if (visited[next] != round)
+					{
+						visited[next] = round;
+						previous[next] = node;
+						pending.push(next);
+					}
+				}
+			}
+			if (visited[second] != round) {
+				return 0;
+			}
+			unsigned long long length = 1;
+			for (unsigned int node = second; node != first; node = previous[node]) {
+				length++;
+			}
+			return length;
+		};
+
+		ForestStats stats;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& operation : trace.operations)
+		{
+			unsigned int first = operation.first;
+			unsigned int second = operation.second;
+			if (operation.kind == ForestOperation::Relink)
+			{
+				if (parents[first] != first)
+				{
+					unlink(first, parents[first]);
+					unlink(parents[first], first);
+					parents[first] = first;
+				}
+				if (path(first, second) == 0)
+				{
+					adjacent[first].push_back(second);
+					adjacent[second].push_back(first);
+					parents[first] = second;
+				}
+			}
+			else if (unsigned long long length = path(first, second)) {
+				stats.checksum += operation.kind == ForestOperation::Connected ? 1 : length;
+			}
+		}
+		auto finish = std::chrono::steady_clock::now();
+		if (!trace.operations.empty()) {
+			stats.nsPerOperation =
+				std::chrono::duration<double, std::nano>(finish - start).count() / trace.operations.size();
+		}
+		return stats;
+	}
+
+	// Replays trace against any tree exposing Find(key), Depth(node) and Rotations().
+	template<typename Tree, typename K>
+	Stats Replay(Tree& tree, const std::vector<K>& trace)
+	{
+		Stats stats;
+		if (trace.empty()) {
+			return stats;
+		}
+
+		size_t found = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& key : trace) {
+			found += tree.Find(key) != nullptr;
+		}
+		auto finish = std::chrono::steady_clock::now();
+		stats.nsPerLookup =
+			std::chrono::duration<double, std::nano>(finish - start).count() / trace.size();
+		stats.misses = trace.size() - found;
+
+		size_t depth = 0;
+		size_t rotations = 0;
+		for (const auto& key : trace)
+		{
+			size_t before = tree.Rotations();
+			auto node = tree.Find(key);
+			size_t performed = tree.Rotations() - before;
+			if (node) {
+				depth += tree.Depth(node) + performed;
+			}
+			rotations += performed;
+		}
+		stats.averageDepth = found ? static_cast<double>(depth) / found : 0;
+		stats.rotationsPerLookup = static_cast<double>(rotations) / trace.size();
+		return stats;
+	}
+
+	// Replays trace against any cache exposing Find(key) and Insert(key, data).
+	template<typename Cache, typename K>
+	CacheStats ReplayCache(Cache& cache, const std::vector<K>& trace)
+	{
+		CacheStats stats;
+		if (trace.empty()) {
+			return stats;
+		}
+
+		size_t hits = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& key : trace)
+		{
+			if (cache.Find(key)) {
+				hits++;
+			}
+			else {
+				cache.Insert(key, {});
+			}
+		}
+		auto finish = std::chrono::steady_clock::now();
+		stats.nsPerAccess =
+			std::chrono::duration<double, std::nano>(finish - start).count() / trace.size();
+		stats.hitRate = static_cast<double>(hits) / trace.size();
+		return stats;
+	}
+}
+
+// Usage example
+//auto trace = AccessTrace::Zipf(1 << 16, 1 << 22, 1.1);
+//SplayBST<unsigned int, int> splay;
+//for (unsigned int key = 0; key < (1 << 16); key++) {
+//	splay.Insert(key, 0);
+//}
+//auto stats = AccessTrace::Replay(splay, trace);
+//std::cout << stats.nsPerLookup << " ns, depth " << stats.averageDepth
+//	<< ", rotations " << stats.rotationsPerLookup << std::endl;
+//SplayCache<unsigned int, int> splayCache(1 << 12);
+//AccessTrace::LruCache<unsigned int, int> lruCache(1 << 12);
+//auto splayStats = AccessTrace::ReplayCache(splayCache, trace);
+//auto lruStats = AccessTrace::ReplayCache(lruCache, trace);
+//auto forest = AccessTrace::DynamicForest(1 << 17, 1 << 14);
+//LinkCutTree<unsigned long long> linkCut(1 << 17, 1);
+//auto linkCutStats = AccessTrace::ReplayForest(linkCut, forest);
+//auto bfsStats = AccessTrace::ReplayForestBfs(forest);
+//std::cout << linkCutStats.nsPerOperation << " vs " << bfsStats.nsPerOperation << " ns, "
+//	<< (linkCutStats.checksum == bfsStats.checksum ? "same" : "different") << " answers" << std::endl;
@@ -0,0 +1,66 @@
+//**************************************************************************************
+//								< Tree Nodes >
+//**************************************************************************************
+// Type:		Binary tree building block
+// Purpose:		Node teardown and unlinking shared by the pointer-based search trees
+// Name:		Tree nodes
+// Implementation details:
+//		> Node needs parent, left and right pointers and has to befriend TreeNodes<Node>,
+//		  Depth also needs isRoot().
+//		> Clear flattens the tree with right rotations while deleting it: constant
+//		  stack even for a degenerate tree, and no parent pointer is touched.
+//
+//**************************************************************************************
+
+#pragma once
+
+template<typename Node>
+struct TreeNodes
+{
+	// Deletes every node under root.
+	static void Clear(Node* root)
+	{
+		Node* node = root;
+		while (node != nullptr)
+		{
+			if (node->left != nullptr)
+			{
+				Node* left = node->left;
+				node->left = left->right;
+				left->right = node;
+				node = left;
+			}
+			else
+			{
+				Node* right = node->right;
+				delete node;
+				node = right;
+			}
+		}
+	}
+
+	// Number of edges between node and the root.
+	static unsigned int Depth(const Node* node)
+	{
+		unsigned int depth = 0;
+		for (; node && !node->isRoot(); node = node->parent) {
+			depth++;
+		}
+		return depth;
+	}
+
+	// Unlinks node from its parent, if it has one.
+	static void Detach(Node* node)
+	{
+		Node* parent = node->parent;
+		if (parent == nullptr) {
+			return;
+		}
+		if (parent->left == node) {
+			parent->left = nullptr;
+		} else {
+			parent->right = nullptr;
+		}
+		node->parent = nullptr;
+	}
+};
@@ -3,51 +3,71 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <iterator>
+
+template<typename T>
+class BinomialHeap;
 
 template<typename T>
 class BinomialTree
 {
+	friend class BinomialHeap<T>;
 public:
 	class Node;
 
 private:
-	std::unique_ptr<Node> root;
-	unsigned int order = 0;
+	Node* root = nullptr;	// nodes are owned by the node pool of the heap
 
 public:
 	BinomialTree() = default;
-	BinomialTree(const T& value)
-		: root{ std::make_unique<Node>(value) }
+	BinomialTree(Node* _root)
+		: root{ _root }
+	{
+	}
+	BinomialTree(BinomialTree&& tree) noexcept
+		: root{ tree.root }
 	{
+		tree.root = nullptr;
 	}
-	BinomialTree(std::unique_ptr<Node>& _root, unsigned int _order)
-		: root{ std::move(_root) }, order{ _order }
+	BinomialTree& operator=(BinomialTree&& tree) noexcept
 	{
+		if (this != &tree)
+		{
+			root = tree.root;
+			tree.root = nullptr;
+		}
+		return *this;
 	}
 
+public:
+	BinomialTree(const BinomialTree& tree) = delete;
+	BinomialTree& operator=(const BinomialTree& tree) = delete;
+
 private:
-	BinomialTree& append(BinomialTree& tree) 
+	BinomialTree& append(BinomialTree& tree)
 	{
 		root->append(tree.root);
-		order++;
+		tree.root = nullptr;
 		return *this;
 	}
 
 public:
-	Node* Root()					{ return root.get(); }
-	const Node* Root()		const	{ return root.get(); }
-	unsigned int Order()	const	{ return order; }
+	Node* Root()					{ return root; }
+	const Node* Root()		const	{ return root; }
+	unsigned int Order()	const	{ return root ? root->order : 0; }
 
 public:
 	static BinomialTree Merge(BinomialTree& first, BinomialTree& second)
 	{
-		if (first.order != second.order) {
+		if (first.Order() != second.Order()) {
 			throw std::runtime_error("Attempt to merge binomial trees of the different order.");
 		}
 
 		if (!first.root) {
 			return std::move(second);
-		} 
+		}
 		if (!second.root) {
 			return std::move(first);
 		}
@@ -61,9 +81,7 @@ public:
 
 };
 
-template<typename T>
-class BinomialHeap;
-
+// Left-child / right-sibling layout: children are chained from the highest order down.
 template<typename T>
 class BinomialTree<T>::Node
 {
@@ -71,23 +89,43 @@ class BinomialTree<T>::Node
 	friend class BinomialHeap<T>;
 private:
 	T value;
-	std::vector<
-		std::unique_ptr<Node>> children;
+	unsigned int order = 0;
+
+	Node* child		= nullptr;	// child of the highest order
+	Node* sibling	= nullptr;	// next child of the same parent, one order lower
+	Node* prev		= nullptr;	// previous sibling, or the parent for the first child
 
 public:
-	Node(const T& _value)
-		: value{ _value }
+	template<typename... Args>
+	explicit Node(Args&&... args)
+		: value(std::forward<Args>(args)...)
 	{
 	}
 
+public:
+	Node(const Node& node) = delete;
+	Node& operator=(const Node& node) = delete;
+
 public:
 	const T& Value() const {
 		return value;
 	}
+	unsigned int Order() const {
+		return order;
+	}
+	bool isRoot() const {
+		return prev == nullptr;
+	}
 
 private:
-	void append(std::unique_ptr<Node>& root) {
-		children.push_back(std::move(root));
+	void append(Node* node) {
+		node->sibling = child;
+		if (child) {
+			child->prev = node;
+		}
+		node->prev = this;
+		child = node;
+		order++;
 	}
 };
 
@@ -97,66 +135,292 @@ class BinomialHeap
 	typedef BinomialTree<T> Tree;
 	typedef typename Tree::Node Node;
 
+public:
+	// Stays valid until its value is popped or erased.
+	typedef const Node* Handle;
+
 private:
-	std::vector<Tree> trees;
+	// Node storage of the heap: chunks of raw slots, recycled through a free list.
+	class Pool
+	{
+	private:
+		typedef typename std::aligned_storage<sizeof(Node), alignof(Node)>::type Slot;
+		struct FreeSlot { FreeSlot* next; };
+
+		std::vector<std::unique_ptr<Slot[]>> chunks;
+		FreeSlot* head		= nullptr;
+		FreeSlot* tail		= nullptr;
+		size_t capacity		= 0;
+		size_t available	= 0;
+
+	public:
+		Pool() = default;
+		Pool(const Pool& pool) = delete;
+		Pool& operator=(const Pool& pool) = delete;
+
+	public:
+		template<typename... Args>
+		Node* Acquire(Args&&... args)
+		{
+			if (head == nullptr) {
+				allocate(std::max<size_t>(capacity, 16));
+			}
+			FreeSlot* slot = head;
+			head = head->next;
+			if (head == nullptr) {
+				tail = nullptr;
+			}
+			available--;
+			try {
+				return new (slot) Node(std::forward<Args>(args)...);
+			} catch (...) {
+				push(slot);
+				throw;
+			}
+		}
+		void Release(Node* node)
+		{
+			node->~Node();
+			push(new (node) FreeSlot{ nullptr });
+		}
+		// makes sure count nodes can be acquired without further allocations
+		void Reserve(size_t count)
+		{
+			if (available < count) {
+				allocate(count - available);
+			}
+		}
+		// takes over the chunks and free slots of another pool
+		void Absorb(Pool& pool)
+		{
+			for (auto& chunk : pool.chunks) {
+				chunks.push_back(std::move(chunk));
+			}
+			capacity += pool.capacity;
+			available += pool.available;
+			if (pool.head)
+			{
+				if (tail) {
+					tail->next = pool.head;
+				} else {
+					head = pool.head;
+				}
+				tail = pool.tail;
+			}
+			pool.chunks.clear();
+			pool.head = pool.tail = nullptr;
+			pool.capacity = pool.available = 0;
+		}
+		void Swap(Pool& pool)
+		{
+			std::swap(chunks, pool.chunks);
+			std::swap(head, pool.head);
+			std::swap(tail, pool.tail);
+			std::swap(capacity, pool.capacity);
+			std::swap(available, pool.available);
+		}
+
+	private:
+		void push(FreeSlot* slot)
+		{
+			slot->next = head;
+			head = slot;
+			if (tail == nullptr) {
+				tail = slot;
+			}
+			available++;
+		}
+		void allocate(size_t count)
+		{
+			chunks.emplace_back(new Slot[count]);
+			Slot* chunk = chunks.back().get();
+			for (size_t i = count; i > 0; i--) {
+				push(new (&chunk[i - 1]) FreeSlot{ nullptr });
+			}
+			capacity += count;
+		}
+	};
+
+private:
+	std::vector<Tree> trees;	// trees[order] is the tree of that order or an empty one
 	__int64 minTreeIndex = -1;
+	size_t size = 0;
+	Pool pool;
 
 public:
 	BinomialHeap() = default;
-	BinomialHeap(const T& value) 
-		: minTreeIndex{ 0 }
+	BinomialHeap(const T& value)
+	{
+		Push(value);
+	}
+	BinomialHeap(T&& value)
+	{
+		Push(std::move(value));
+	}
+	// O(n): every element costs one amortized carry step and the nodes come from a single chunk
+	template<typename Iterator>
+	BinomialHeap(Iterator first, Iterator last)
+	{
+		reserve(first, last, typename std::iterator_traits<Iterator>::iterator_category());
+		for (; first != last; ++first) {
+			insertTree(pool.Acquire(*first));
+		}
+		updateMinTree();
+	}
+	BinomialHeap(BinomialHeap&& heap)
+	{
+		Swap(heap);
+	}
+	BinomialHeap& operator=(BinomialHeap&& heap)
 	{
-		trees.emplace_back(value);
+		Swap(heap);
+		return *this;
 	}
-	BinomialHeap(std::vector<std::unique_ptr<Node>>& roots)
+	~BinomialHeap()
 	{
-		unsigned int order = 0;
-		for (auto& root : roots) {
-			trees.emplace_back(root, order++);
+		// the chunks go away with the pool, only values may need destructors
+		if (!std::is_trivially_destructible<T>::value) {
+			Clear();
 		}
 	}
 
+public:
+	BinomialHeap(const BinomialHeap& heap) = delete;
+	BinomialHeap& operator=(const BinomialHeap& heap) = delete;
+
 private:
-	void append(Tree& tree) 
+	void updateMinTree()
 	{
-		auto treeIter = trees.insert(trees.end(), std::move(tree));
-		if (minTreeIndex == -1 || treeIter->Root()->Value() < First()) {
-			minTreeIndex = treeIter - trees.begin();
+		minTreeIndex = -1;
+		for (size_t order = 0; order < trees.size(); order++)
+		{
+			if (trees[order].Root() && (minTreeIndex == -1 || trees[order].Root()->Value() < First())) {
+				minTreeIndex = order;
+			}
 		}
 	}
-	auto appendOrMerge(Tree& tree) 
+	void trim()
 	{
-		if (trees.empty()) {
-			append(tree);
+		while (!trees.empty() && !trees.back().Root()) {
+			trees.pop_back();
 		}
+	}
 
-		auto& lastInsertedTree = trees.back();
-		if (tree.Order() > lastInsertedTree.Order()) {
-			append(tree);
-		} else { // tree.order == lastInsertedTree.order
-			lastInsertedTree = Tree::Merge(tree, lastInsertedTree);
-		}
+	template<typename Iterator>
+	void reserve(Iterator first, Iterator last, std::forward_iterator_tag)
+	{
+		pool.Reserve(std::distance(first, last));
 	}
-	
-public:
-	void Push(const T& value)
+	template<typename Iterator>
+	void reserve(Iterator, Iterator, std::input_iterator_tag)
 	{
-		BinomialHeap heap{ value };
-		*this = Merge(*this, heap);
 	}
+
+	size_t insertTree(Node* node);
+	void addTrees(Tree* roots, size_t count);
+	void destroy(Node* node);
+
+	Handle insert(Node* node);
+	template<typename Value>
+	void decreaseKey(Handle handle, Value&& value);
+
+	Node* parentOf(Node* node) const;
+	void swapWithParent(Node* node, Node* parent);
+	Node* siftUp(Node* node, bool toRoot);
+
+public:
+	Handle Push(const T& value)
+		{ return insert(pool.Acquire(value)); }
+	Handle Push(T&& value)
+		{ return insert(pool.Acquire(std::move(value))); }
+	template<typename... Args>
+	Handle Emplace(Args&&... args)
+		{ return insert(pool.Acquire(std::forward<Args>(args)...)); }
+
 	void Pop()
 	{
 		if (minTreeIndex == -1) {
 			throw std::runtime_error("BinomialHeap is empty.");
-		} 
-		auto minTree = std::move(trees[minTreeIndex]);
-		trees.erase(trees.begin() + minTreeIndex);
-		BinomialHeap heap{ minTree.Root()->children };
-		*this = Merge(*this, heap);
+		}
+		Node* root = trees[minTreeIndex].Root();
+		trees[minTreeIndex].root = nullptr;
+
+		// children of an order k root are complete trees of orders k-1 .. 0
+		Tree children[64];
+		for (Node* child = root->child; child != nullptr; )
+		{
+			Node* next = child->sibling;
+			child->prev = child->sibling = nullptr;
+			children[child->order] = Tree(child);
+			child = next;
+		}
+		unsigned int order = root->order;
+		pool.Release(root);
+		size--;
+
+		addTrees(children, order);
+		trim();
+		updateMinTree();
+	}
+	// Pops the minimum and hands it over by move.
+	T PopValue()
+	{
+		if (minTreeIndex == -1) {
+			throw std::runtime_error("BinomialHeap is empty.");
+		}
+		T value = std::move(trees[minTreeIndex].Root()->value);
+		Pop();
+		return value;
 	}
 	const T& First() const {
 		return trees[minTreeIndex].Root()->Value();
 	}
+	const T& Top() const {
+		return First();
+	}
+
+	// Pops every element into out in ascending order, leaving the heap empty.
+	template<typename OutputIterator>
+	OutputIterator DrainSorted(OutputIterator out)
+	{
+		while (minTreeIndex != -1)
+		{
+			*out = std::move(trees[minTreeIndex].Root()->value);
+			++out;
+			Pop();
+		}
+		return out;
+	}
+
+	void Meld(BinomialHeap&& heap);
+	void DecreaseKey(Handle handle, const T& value)
+		{ decreaseKey(handle, value); }
+	void DecreaseKey(Handle handle, T&& value)
+		{ decreaseKey(handle, std::move(value)); }
+	void Erase(Handle handle);
+	void Clear();
+
+	// Makes sure count more elements can be pushed without allocating.
+	void Reserve(size_t count)
+	{
+		pool.Reserve(count);
+		trees.reserve(64);
+	}
+
+	bool Empty() const {
+		return size == 0;
+	}
+	size_t Size() const {
+		return size;
+	}
+
+	void Swap(BinomialHeap& heap)
+	{
+		std::swap(trees, heap.trees);
+		std::swap(minTreeIndex, heap.minTreeIndex);
+		std::swap(size, heap.size);
+		pool.Swap(heap.pool);
+	}
 
 public:
 	static BinomialHeap Merge(BinomialHeap& first, BinomialHeap& second);
@@ -166,40 +430,237 @@ template<typename T>
 inline BinomialHeap<T> BinomialHeap<T>::Merge(BinomialHeap& first, BinomialHeap& second)
 {
 	BinomialHeap result;
-	auto firstIter = first.trees.begin();
-	auto firstEnd = first.trees.end();
-	auto secondIter = second.trees.begin();
-	auto secondEnd = second.trees.end();
-	while (firstIter != firstEnd && secondIter != secondEnd)
+	result.Swap(first);
+	result.Meld(std::move(second));
+	return result;
+}
+
+template<typename T>
+inline void BinomialHeap<T>::Meld(BinomialHeap&& heap)
+{
+	if (&heap == this || heap.Empty()) {
+		return;
+	}
+	// add the shorter forest into the longer one: carries die out after its last order
+	if (heap.trees.size() > trees.size()) {
+		Swap(heap);
+	}
+	if (heap.Empty()) {
+		return;
+	}
+
+	Node* minimum = heap.trees[heap.minTreeIndex].Root();
+	if (minTreeIndex != -1 && !(minimum->value < First())) {
+		minimum = trees[minTreeIndex].Root();
+	}
+
+	pool.Absorb(heap.pool);
+	addTrees(heap.trees.data(), heap.trees.size());
+	size += heap.size;
+
+	heap.trees.clear();
+	heap.minTreeIndex = -1;
+	heap.size = 0;
+
+	// the old minimum is still a root, unless it was linked under an equal value
+	while (!minimum->isRoot()) {
+		minimum = parentOf(minimum);
+	}
+	minTreeIndex = minimum->order;
+}
+
+template<typename T>
+inline typename BinomialHeap<T>::Handle BinomialHeap<T>::insert(Node* node)
+{
+	size_t order = insertTree(node);
+
+	// the carry root is the minimum of every root linked into it
+	if (minTreeIndex == -1 || minTreeIndex < (__int64) order || trees[order].Root()->Value() < First()) {
+		minTreeIndex = order;
+	}
+	return node;
+}
+
+// Binary counter increment: links carries in place until a free order is met.
+// Returns the order the carry ended up in.
+template<typename T>
+inline size_t BinomialHeap<T>::insertTree(Node* node)
+{
+	Tree carry{ node };
+	size_t order = 0;
+	for (; order < trees.size() && trees[order].Root(); order++) {
+		carry = Tree::Merge(trees[order], carry);
+	}
+	if (order == trees.size()) {
+		trees.emplace_back();
+	}
+	trees[order] = std::move(carry);
+	size++;
+	return order;
+}
+
+// Binary addition of a forest (roots[order] is a tree of that order or empty) into trees.
+template<typename T>
+inline void BinomialHeap<T>::addTrees(Tree* roots, size_t count)
+{
+	Tree carry;
+	for (size_t order = 0; order < count || carry.Root(); order++)
 	{
-		if (firstIter->Order() < secondIter->Order()) 
-		{
-			result.appendOrMerge(*firstIter);
-			firstIter++;
+		if (order == trees.size()) {
+			trees.emplace_back();
+		}
+
+		Tree* present[3];
+		int number = 0;
+		if (trees[order].Root()) {
+			present[number++] = &trees[order];
+		}
+		if (order < count && roots[order].Root()) {
+			present[number++] = &roots[order];
+		}
+		if (carry.Root()) {
+			present[number++] = &carry;
+		}
+
+		Tree kept;
+		if (number % 2 == 1) {
+			kept = std::move(*present[number - 1]);
 		}
-		else if (firstIter->Order() > secondIter->Order()) 
+		Tree next;
+		if (number >= 2) {
+			next = Tree::Merge(*present[0], *present[1]);
+		}
+		trees[order] = std::move(kept);
+		carry = std::move(next);
+	}
+}
+
+// Releases a whole tree without recursion: rotating the first child up turns
+// the child / sibling links into a single chain.
+template<typename T>
+inline void BinomialHeap<T>::destroy(Node* node)
+{
+	while (node != nullptr)
+	{
+		if (node->child)
 		{
-			result.appendOrMerge(*secondIter);
-			secondIter++;
+			Node* child = node->child;
+			node->child = child->sibling;
+			child->sibling = node;
+			node = child;
 		}
-		else 
+		else
 		{
-			result.append(Tree::Merge(*firstIter, *secondIter));
-			firstIter++;
-			secondIter++;
+			Node* next = node->sibling;
+			pool.Release(node);
+			node = next;
 		}
 	}
-	if (secondIter != secondEnd)
+}
+
+template<typename T>
+inline void BinomialHeap<T>::Clear()
+{
+	for (auto& tree : trees)
+	{
+		destroy(tree.Root());
+		tree.root = nullptr;
+	}
+	trees.clear();
+	minTreeIndex = -1;
+	size = 0;
+}
+
+template<typename T>
+inline typename BinomialHeap<T>::Node* BinomialHeap<T>::parentOf(Node* node) const
+{
+	// walk back to the first child, whose prev is the parent
+	while (node->prev && node->prev->child != node) {
+		node = node->prev;
+	}
+	return node->prev;
+}
+
+template<typename T>
+inline void BinomialHeap<T>::swapWithParent(Node* node, Node* parent)
+{
+	Node* parentPrev = parent->prev;
+	Node* parentSibling = parent->sibling;
+	Node* nodePrev = node->prev;
+	Node* nodeSibling = node->sibling;
+	Node* nodeChild = node->child;
+
+	// node takes the place of parent among its siblings
+	if (parentPrev == nullptr) {
+		trees[parent->order].root = node;
+	} else if (parentPrev->child == parent) {
+		parentPrev->child = node;
+	} else {
+		parentPrev->sibling = node;
+	}
+	if (parentSibling) {
+		parentSibling->prev = node;
+	}
+	node->prev = parentPrev;
+	node->sibling = parentSibling;
+
+	// node adopts the children of parent, parent takes the place of node among them
+	if (nodePrev == parent)
 	{
-		firstIter = secondIter;
-		firstEnd = secondEnd;
+		node->child = parent;
+		parent->prev = node;
 	}
-	if (firstIter != firstEnd)
+	else
 	{
-		std::for_each(firstIter, firstEnd, [&] (Tree& tree) {
-			result.appendOrMerge(tree);
-		});
+		node->child = parent->child;
+		node->child->prev = node;
+		nodePrev->sibling = parent;
+		parent->prev = nodePrev;
+	}
+	parent->sibling = nodeSibling;
+	if (nodeSibling) {
+		nodeSibling->prev = parent;
+	}
+
+	// parent adopts the children of node
+	parent->child = nodeChild;
+	if (nodeChild) {
+		nodeChild->prev = parent;
+	}
+
+	std::swap(node->order, parent->order);
+}
+
+template<typename T>
+inline typename BinomialHeap<T>::Node* BinomialHeap<T>::siftUp(Node* node, bool toRoot)
+{
+	// finding each parent costs the distance to the first child, which
+	// telescopes along the path, so the whole sift-up is O(log n)
+	for (Node* parent = parentOf(node); parent && (toRoot || node->value < parent->value); parent = parentOf(node)) {
+		swapWithParent(node, parent);
 	}
+	return node;
+}
 
-	return std::move(result);
+template<typename T>
+template<typename Value>
+inline void BinomialHeap<T>::decreaseKey(Handle handle, Value&& value)
+{
+	Node* node = const_cast<Node*>(handle);
+	if (node->value < value) {
+		throw std::runtime_error("DecreaseKey failed: new value is greater than the current one.");
+	}
+	node->value = std::forward<Value>(value);
+	siftUp(node, false);
+	if (node->isRoot() && node->value < First()) {
+		minTreeIndex = node->order;
+	}
+}
+
+template<typename T>
+inline void BinomialHeap<T>::Erase(Handle handle)
+{
+	Node* node = siftUp(const_cast<Node*>(handle), true);
+	minTreeIndex = node->order;
+	Pop();
 }
@@ -0,0 +1,327 @@
+//**************************************************************************************
+//								< External Heap >
+//**************************************************************************************
+// Type:		External-memory priority queue
+// Purpose:		Priority queue for more elements than fit into a memory budget
+// Name:		External heap
+// Implementation details:
+//		> Pushes go to an in-memory BinomialHeap buffer. A full buffer is drained in
+//		  order into a sorted run in a temporary file (std::tmpfile, removed on close).
+//		> Every run streams through a block of BlockBytes, the current block heads
+//		  are kept in a second BinomialHeap: Pop takes the smaller of its top and the
+//		  buffer top, a k-way merge that reads every run front to back.
+//		> Half of the budget goes to the buffer, the other half to run blocks. When
+//		  the runs would not fit any more the smallest half of them is merged into a
+//		  single one. Runs merged together are of similar size, so an element is
+//		  rewritten about log(spills) / log(fan-in) times rather than on every merge.
+//		> Runs are only read and written front to back.
+//		> T is written as raw bytes, so it has to be trivially copyable.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "BinomialHeap.h"
+
+template<typename T>
+class ExternalHeap
+{
+	static_assert(std::is_trivially_copyable<T>::value,
+		"ExternalHeap spills raw bytes: T must be trivially copyable.");
+
+private:
+	// Sorted spilled elements, read back block by block.
+	struct Run
+	{
+		std::FILE* file = nullptr;
+		std::vector<T> block;
+		size_t position		= 0;	// next element of block
+		size_t remaining	= 0;	// elements left in the file
+
+		Run()
+			: file(std::tmpfile())
+		{
+			if (file == nullptr) {
+				throw std::runtime_error("ExternalHeap error: cannot create a temporary file.");
+			}
+		}
+		~Run()
+		{
+			std::fclose(file);
+		}
+		Run(const Run& run) = delete;
+		Run& operator=(const Run& run) = delete;
+	};
+
+	struct Head
+	{
+		T value;
+		size_t run;
+
+		Head(const T& _value, size_t _run)
+			: value(_value), run{ _run }
+		{
+		}
+		bool operator<(const Head& other) const
+		{
+			return value < other.value;
+		}
+	};
+
+	BinomialHeap<T> buffer;
+	BinomialHeap<Head> heads;		// one per live run
+	std::vector<std::unique_ptr<Run>> runs;
+	std::vector<T> output;			// write block of the run being built
+	size_t liveRuns = 0;
+	size_t size = 0;
+
+	size_t bufferCapacity;
+	size_t blockLength;
+	size_t maxRuns;
+	size_t fanIn;					// runs merged at once
+
+public:
+	static const size_t BlockBytes = 1 << 16;
+
+	explicit ExternalHeap(size_t memoryBudget)
+	{
+		// a buffered element costs its node: the value plus four words of links and order
+		bufferCapacity = memoryBudget / 2 / (sizeof(T) + 4 * sizeof(void*));
+		blockLength = std::max<size_t>(BlockBytes / sizeof(T), 1);
+		size_t blocks = memoryBudget / 2 / (blockLength * sizeof(T));
+		if (bufferCapacity == 0 || blocks < 3) {
+			throw std::runtime_error("ExternalHeap construction error: memory budget is too small.");
+		}
+		maxRuns = blocks - 1;		// one block is the write buffer
+		fanIn = std::max<size_t>(maxRuns / 2, 2);
+		buffer.Reserve(bufferCapacity);
+	}
+
+public:
+	ExternalHeap(const ExternalHeap& heap) = delete;
+	ExternalHeap& operator=(const ExternalHeap& heap) = delete;
+
+public:
+	void Push(const T& value);
+	void Pop();
+	T PopValue();
+	const T& Top() const;
+	const T& First() const
+		{ return Top(); }
+	void Clear();
+
+	bool Empty() const
+		{ return size == 0; }
+	size_t Size() const
+		{ return size; }
+	size_t Runs() const
+		{ return liveRuns; }
+
+private:
+	bool fromBuffer() const;
+	bool load(Run& run);
+	void advance(size_t index, BinomialHeap<Head>& into);
+	void flush(Run& run);
+	void write(Run& run, const T& value);
+	void seal(std::unique_ptr<Run> run);
+	void spill();
+	void mergeRuns();
+};
+
+template<typename T>
+inline bool ExternalHeap<T>::fromBuffer() const
+{
+	return heads.Empty() || (!buffer.Empty() && buffer.Top() < heads.Top().value);
+}
+
+template<typename T>
+inline const T& ExternalHeap<T>::Top() const
+{
+	if (size == 0) {
+		throw std::runtime_error("ExternalHeap is empty.");
+	}
+	return fromBuffer() ? buffer.Top() : heads.Top().value;
+}
+
+template<typename T>
+inline void ExternalHeap<T>::Push(const T& value)
+{
+	if (buffer.Size() == bufferCapacity) {
+		spill();
+	}
+	buffer.Push(value);
+	size++;
+}
+
+template<typename T>
+inline void ExternalHeap<T>::Pop()
+{
+	if (size == 0) {
+		throw std::runtime_error("ExternalHeap is empty.");
+	}
+	if (fromBuffer()) {
+		buffer.Pop();
+	}
+	else {
+		advance(heads.PopValue().run, heads);
+	}
+	size--;
+}
+
+template<typename T>
+inline T ExternalHeap<T>::PopValue()
+{
+	T value = Top();
+	Pop();
+	return value;
+}
+
+template<typename T>
+inline void ExternalHeap<T>::Clear()
+{
+	buffer.Clear();
+	heads.Clear();
+	runs.clear();
+	liveRuns = 0;
+	size = 0;
+}
+
+// Reads the next block of a run, false once the run is exhausted.
+template<typename T>
+inline bool ExternalHeap<T>::load(Run& run)
+{
+	size_t count = std::min(blockLength, run.remaining);
+	if (count == 0) {
+		return false;
+	}
+	run.block.resize(count);
+	if (std::fread(run.block.data(), sizeof(T), count, run.file) != count) {
+		throw std::runtime_error("ExternalHeap error: cannot read a spilled run.");
+	}
+	run.remaining -= count;
+	run.position = 0;
+	return true;
+}
+
+// Pushes the next head of a run into a head heap, closing the run when it has none left.
+template<typename T>
+inline void ExternalHeap<T>::advance(size_t index, BinomialHeap<Head>& into)
+{
+	Run& run = *runs[index];
+	if (run.position == run.block.size() && !load(run))
+	{
+		runs[index].reset();
+		liveRuns--;
+		return;
+	}
+	into.Emplace(run.block[run.position++], index);
+}
+
+template<typename T>
+inline void ExternalHeap<T>::flush(Run& run)
+{
+	if (std::fwrite(output.data(), sizeof(T), output.size(), run.file) != output.size()) {
+		throw std::runtime_error("ExternalHeap error: cannot write a spilled run.");
+	}
+	run.remaining += output.size();
+	output.clear();
+}
+
+template<typename T>
+inline void ExternalHeap<T>::write(Run& run, const T& value)
+{
+	output.push_back(value);
+	if (output.size() == blockLength) {
+		flush(run);
+	}
+}
+
+// Rewinds a written run and makes its first element a head.
+template<typename T>
+inline void ExternalHeap<T>::seal(std::unique_ptr<Run> run)
+{
+	flush(*run);
+	if (std::fflush(run->file) != 0) {
+		throw std::runtime_error("ExternalHeap error: cannot write a spilled run.");
+	}
+	std::rewind(run->file);
+
+	// slots of exhausted runs are reused, head indices of live runs stay put
+	size_t index = std::find(runs.begin(), runs.end(), nullptr) - runs.begin();
+	if (index == runs.size()) {
+		runs.push_back(std::move(run));
+	} else {
+		runs[index] = std::move(run);
+	}
+	liveRuns++;
+	advance(index, heads);
+}
+
+template<typename T>
+inline void ExternalHeap<T>::spill()
+{
+	if (liveRuns == maxRuns) {
+		mergeRuns();
+	}
+	std::unique_ptr<Run> run(new Run);
+	while (!buffer.Empty())
+	{
+		write(*run, buffer.Top());
+		buffer.Pop();
+	}
+	seal(std::move(run));
+}
+
+// Replaces the fanIn runs with the fewest elements left with a single one.
+template<typename T>
+inline void ExternalHeap<T>::mergeRuns()
+{
+	std::vector<std::pair<size_t, size_t>> lengths;		// { elements left with the head, run }
+	for (size_t index = 0; index < runs.size(); index++)
+	{
+		const Run* run = runs[index].get();
+		if (run != nullptr) {
+			lengths.emplace_back(run->remaining + run->block.size() - run->position + 1, index);
+		}
+	}
+	std::nth_element(lengths.begin(), lengths.begin() + (fanIn - 1), lengths.end());
+	std::vector<bool> merged(runs.size(), false);
+	for (size_t i = 0; i < fanIn; i++) {
+		merged[lengths[i].second] = true;
+	}
+
+	// the heads of the merged runs move to a heap of their own
+	BinomialHeap<Head> kept, merging;
+	while (!heads.Empty())
+	{
+		Head head = heads.PopValue();
+		(merged[head.run] ? merging : kept).Push(head);
+	}
+	heads.Swap(kept);
+
+	std::unique_ptr<Run> run(new Run);
+	while (!merging.Empty())
+	{
+		Head head = merging.PopValue();
+		write(*run, head.value);
+		advance(head.run, merging);
+	}
+	seal(std::move(run));
+}
+
+// Usage example
+//struct Record { unsigned long long key; unsigned int id; };	// with operator< on key
+//ExternalHeap<Record> queue(size_t(256) << 20);
+//for (const auto& record : input) {
+//	queue.Push(record);
+//}
+//while (!queue.Empty()) {
+//	Emit(queue.PopValue());
+//}
@@ -0,0 +1,194 @@
+//**************************************************************************************
+//								< Multi Queue >
+//**************************************************************************************
+// Type:		Relaxed concurrent priority queue
+// Purpose:		Scalable task scheduling where an approximate minimum is good enough
+// Name:		MultiQueue
+// Implementation details:
+//		> factor * threads BinomialHeap instances, each behind its own mutex that is
+//		  only ever try-locked on the fast path, so a busy heap is skipped, not waited on.
+//		> Push goes to a random heap, TryPop takes the smaller top of two random heaps.
+//		  If the second heap is busy it retries with a fresh pair, and only after
+//		  Retries busy pairs in one call it pops from the single heap it holds. Such
+//		  single-choice pops are not covered by the bound below. They stay rare
+//		  unless the threads far outnumber the heaps.
+//		> Rank error: with n = factor * threads heaps the popped element is expected to
+//		  have O(n) smaller elements still queued, O(n log n) with high probability
+//		  (two-choice analysis, Alistarh et al. 2017). A single random choice has no
+//		  such bound: the error grows with the number of operations.
+//		> Elements pushed by one thread are not popped in FIFO or priority order
+//		  relative to each other, only approximately.
+//		> TryPop fails only after a sweep has seen every heap empty; under concurrent
+//		  pushes this is a moment-in-time answer, not a linearizable one.
+//		> Each heap sits on its own cache lines. Before C++17 new ignores alignas,
+//		  so the heaps are constructed in storage aligned by hand.
+//		> MultiQueueBenchmark.h measures throughput and rank error.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <mutex>
+#include <new>
+#include <memory>
+#include <random>
+#include <thread>
+#include <stdexcept>
+#include <functional>
+#include "BinomialHeap.h"
+
+template<typename T>
+class MultiQueue
+{
+private:
+	struct alignas(64) Queue
+	{
+		std::mutex lock;
+		BinomialHeap<T> heap;
+	};
+
+	std::unique_ptr<char[]> storage;	// the queues plus room to align them
+	Queue* queues;
+	size_t count;
+
+public:
+	explicit MultiQueue(size_t threads, size_t factor = 2)
+		: count(threads * factor)
+	{
+		if (count < 2) {
+			throw std::runtime_error("MultiQueue construction error: at least two heaps are required.");
+		}
+		size_t space = (count + 1) * sizeof(Queue);
+		storage.reset(new char[space]);
+		void* start = storage.get();
+		queues = static_cast<Queue*>(std::align(alignof(Queue), count * sizeof(Queue), start, space));
+		for (size_t i = 0; i < count; i++) {
+			new (queues + i) Queue;
+		}
+	}
+	~MultiQueue()
+	{
+		for (size_t i = 0; i < count; i++) {
+			queues[i].~Queue();
+		}
+	}
+
+public:
+	MultiQueue(const MultiQueue& queue) = delete;
+	MultiQueue& operator=(const MultiQueue& queue) = delete;
+
+public:
+	// busy second heaps TryPop retries past before it settles for a single choice
+	static const size_t Retries = 4;
+
+	void Push(const T& value)
+		{ insert(value); }
+	void Push(T&& value)
+		{ insert(std::move(value)); }
+	template<typename... Args>
+	void Emplace(Args&&... args)
+		{ insert(T(std::forward<Args>(args)...)); }
+
+	// Moves an approximate minimum into value, false if every heap was seen empty.
+	bool TryPop(T& value);
+
+	size_t Queues() const
+		{ return count; }
+
+private:
+	static size_t random(size_t bound);
+
+	template<typename Value>
+	void insert(Value&& value);
+};
+
+template<typename T>
+inline size_t MultiQueue<T>::random(size_t bound)
+{
+	thread_local std::minstd_rand generator(
+		static_cast<unsigned int>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+	return generator() % bound;
+}
+
+template<typename T>
+template<typename Value>
+inline void MultiQueue<T>::insert(Value&& value)
+{
+	while (true)
+	{
+		Queue& queue = queues[random(count)];
+		if (queue.lock.try_lock())
+		{
+			std::lock_guard<std::mutex> guard(queue.lock, std::adopt_lock);
+			queue.heap.Push(std::forward<Value>(value));
+			return;
+		}
+	}
+}
+
+template<typename T>
+inline bool MultiQueue<T>::TryPop(T& value)
+{
+	// two-choice rounds, each heap is expected to come up twice before giving up
+	size_t busy = 0;
+	for (size_t attempt = 0; attempt < count; attempt++)
+	{
+		size_t i = random(count);
+		size_t j = random(count - 1);
+		if (j >= i) {
+			j++;
+		}
+		Queue& first = queues[i];
+		if (!first.lock.try_lock()) {
+			continue;
+		}
+		Queue& second = queues[j];
+		Queue* chosen = &first;
+		if (second.lock.try_lock())
+		{
+			if (first.heap.Empty() ||
+				(!second.heap.Empty() && second.heap.Top() < first.heap.Top()))
+			{
+				chosen = &second;
+				first.lock.unlock();
+			}
+			else {
+				second.lock.unlock();
+			}
+		}
+		else if (busy < Retries)
+		{
+			// a fresh pair keeps the two-choice bound
+			busy++;
+			first.lock.unlock();
+			continue;
+		}
+		if (!chosen->heap.Empty())
+		{
+			value = chosen->heap.PopValue();
+			chosen->lock.unlock();
+			return true;
+		}
+		chosen->lock.unlock();
+	}
+
+	// the queue looks drained, confirm it with blocking locks
+	for (size_t i = 0; i < count; i++)
+	{
+		std::lock_guard<std::mutex> guard(queues[i].lock);
+		if (!queues[i].heap.Empty())
+		{
+			value = queues[i].heap.PopValue();
+			return true;
+		}
+	}
+	return false;
+}
+
+// Usage example
+//MultiQueue<std::pair<int, Task*>> tasks(std::thread::hardware_concurrency());
+//tasks.Push({ priority, task });
+//std::pair<int, Task*> next;
+//while (tasks.TryPop(next)) {
+//	next.second->Run();
+//}
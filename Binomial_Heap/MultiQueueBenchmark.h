@@ -0,0 +1,148 @@
+//**************************************************************************************
+//								< MultiQueue Benchmark >
+//**************************************************************************************
+// Type:		Benchmark utility
+// Purpose:		Throughput and rank error of MultiQueue against a BinomialHeap behind
+//				a single mutex
+// Name:		MultiQueue benchmark
+// Implementation details:
+//		> Throughput prefills the queue, then every thread alternates Push of a random
+//		  key and TryPop, the steady state of a task scheduler. Reported in million
+//		  operations per second over all threads.
+//		> RankError pushes the keys [0, n) and pops half of them. The rank of a
+//		  popped key is the number of smaller keys still queued, counted exactly with
+//		  a Fenwick tree. A strict priority queue always pops rank 0.
+//		> Any queue of unsigned long long keys exposing Push(key) and TryPop(key) can
+//		  be measured, LockedHeap is the single-lock baseline.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "BinomialHeap.h"
+
+namespace MultiQueueBenchmark
+{
+	struct Stats
+	{
+		double mopsPerSecond		= 0;
+		double meanRankError		= 0;
+		std::size_t maxRankError	= 0;
+	};
+
+	// Reference queue: one BinomialHeap behind one mutex.
+	template<typename T>
+	class LockedHeap
+	{
+	private:
+		std::mutex lock;
+		BinomialHeap<T> heap;
+
+	public:
+		void Push(const T& value)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			heap.Push(value);
+		}
+		bool TryPop(T& value)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (heap.Empty()) {
+				return false;
+			}
+			value = heap.PopValue();
+			return true;
+		}
+	};
+
+	// Alternating Push and TryPop of random keys from threads threads.
+	template<typename Queue>
+	Stats Throughput(Queue& queue, unsigned int threads, std::size_t operations, std::size_t prefill)
+	{
+		std::mt19937_64 random{ 1 };
+		for (std::size_t i = 0; i < prefill; i++) {
+			queue.Push(random());
+		}
+
+		std::vector<std::thread> workers;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int thread = 0; thread < threads; thread++)
+		{
+			workers.emplace_back([&queue, thread, operations]
+			{
+				std::mt19937_64 keys{ thread + 2u };
+				unsigned long long key;
+				for (std::size_t i = 0; i < operations; i += 2)
+				{
+					queue.Push(keys());
+					queue.TryPop(key);
+				}
+			});
+		}
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		auto finish = std::chrono::steady_clock::now();
+
+		Stats stats;
+		double seconds = std::chrono::duration<double>(finish - start).count();
+		stats.mopsPerSecond = threads * operations / seconds / 1e6;
+		return stats;
+	}
+
+	// Ranks of the keys popped after pushing [0, n).
+	template<typename Queue>
+	Stats RankError(Queue& queue, std::size_t n)
+	{
+		Stats stats;
+		// Fenwick tree over the keys still queued
+		std::vector<std::size_t> queued(n + 1, 0);
+		for (std::size_t key = 0; key < n; key++)
+		{
+			queue.Push(key);
+			for (std::size_t i = key + 1; i <= n; i += i & (~i + 1)) {
+				queued[i]++;
+			}
+		}
+
+		std::size_t pops = n / 2;
+		double total = 0;
+		for (std::size_t pop = 0; pop < pops; pop++)
+		{
+			unsigned long long key;
+			if (!queue.TryPop(key)) {
+				break;
+			}
+			std::size_t rank = 0;
+			for (std::size_t i = static_cast<std::size_t>(key); i > 0; i -= i & (~i + 1)) {
+				rank += queued[i];
+			}
+			for (std::size_t i = static_cast<std::size_t>(key) + 1; i <= n; i += i & (~i + 1)) {
+				queued[i]--;
+			}
+			total += rank;
+			stats.maxRankError = std::max(stats.maxRankError, rank);
+		}
+		stats.meanRankError = pops ? total / pops : 0;
+		return stats;
+	}
+}
+
+// Usage example
+//for (unsigned int threads : { 1, 2, 4, 8, 16, 32, 64 }) {
+//	MultiQueue<unsigned long long> relaxed(threads);
+//	MultiQueueBenchmark::LockedHeap<unsigned long long> locked;
+//	auto fast = MultiQueueBenchmark::Throughput(relaxed, threads, 1 << 20, 1 << 20);
+//	auto slow = MultiQueueBenchmark::Throughput(locked, threads, 1 << 20, 1 << 20);
+//	MultiQueue<unsigned long long> ranked(threads);
+//	auto quality = MultiQueueBenchmark::RankError(ranked, 1 << 20);
+//	std::cout << threads << ": " << fast.mopsPerSecond << " vs " << slow.mopsPerSecond
+//		<< " Mops/s, rank error " << quality.meanRankError << std::endl;
+//}
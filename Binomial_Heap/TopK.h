@@ -0,0 +1,144 @@
+//**************************************************************************************
+//								< Top K >
+//**************************************************************************************
+// Type:		Bounded max-side Binomial heap
+// Purpose:		K smallest elements of a stream in O(K) memory
+// Name:		Top-K
+// Implementation details:
+//		> A BinomialHeap with reversed order keeps the worst kept element on top.
+//		> An element that is not better than the worst one is rejected in O(1),
+//		  otherwise the worst one is popped and its pool node is reused by the push.
+//		> The heap arena is reserved for K elements up front, so a streaming pass
+//		  does not allocate.
+//		> Partial results (e.g. one per thread) are combined by Merge: the elements
+//		  of the other selection are offered one by one, so the arena never holds
+//		  more than K nodes.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "BinomialHeap.h"
+
+template<typename T>
+class TopK
+{
+private:
+	// Reverses the order, so the heap minimum is the worst kept element.
+	struct Worse
+	{
+		T value;
+
+		explicit Worse(const T& _value)
+			: value(_value)
+		{
+		}
+		explicit Worse(T&& _value)
+			: value(std::move(_value))
+		{
+		}
+		bool operator<(const Worse& other) const
+		{
+			return other.value < value;
+		}
+	};
+
+	BinomialHeap<Worse> heap;
+	size_t k;
+
+public:
+	explicit TopK(size_t _k)
+		: k{ _k }
+	{
+		if (k == 0) {
+			throw std::runtime_error("TopK construction error: K must be positive.");
+		}
+		heap.Reserve(k);
+	}
+	TopK(TopK&& top) = default;
+	TopK& operator=(TopK&& top) = default;
+
+public:
+	TopK(const TopK& top) = delete;
+	TopK& operator=(const TopK& top) = delete;
+
+public:
+	// Returns whether the value is kept (for now).
+	bool Offer(const T& value)
+		{ return offer(value); }
+	bool Offer(T&& value)
+		{ return offer(std::move(value)); }
+
+	void Merge(TopK&& top);
+	// Moves the kept elements out in ascending order and empties the selection.
+	std::vector<T> Take();
+
+	// The greatest kept element, the bar a new one has to beat once Full().
+	const T& Worst() const
+		{ return heap.Top().value; }
+	bool Full() const
+		{ return heap.Size() == k; }
+	bool Empty() const
+		{ return heap.Empty(); }
+	size_t Size() const
+		{ return heap.Size(); }
+	size_t K() const
+		{ return k; }
+
+private:
+	template<typename Value>
+	bool offer(Value&& value);
+};
+
+template<typename T>
+template<typename Value>
+inline bool TopK<T>::offer(Value&& value)
+{
+	if (heap.Size() == k)
+	{
+		if (!(value < Worst())) {
+			return false;
+		}
+		heap.Pop();
+	}
+	heap.Emplace(std::forward<Value>(value));
+	return true;
+}
+
+template<typename T>
+inline void TopK<T>::Merge(TopK&& top)
+{
+	if (&top == this) {
+		return;
+	}
+	while (!top.heap.Empty()) {
+		offer(std::move(top.heap.PopValue().value));
+	}
+}
+
+template<typename T>
+inline std::vector<T> TopK<T>::Take()
+{
+	std::vector<T> result;
+	result.reserve(heap.Size());
+	while (!heap.Empty()) {
+		result.push_back(std::move(heap.PopValue().value));
+	}
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+// Usage example
+//std::vector<TopK<double>> partial;
+//for (size_t i = 0; i < threads; i++) {
+//	partial.emplace_back(100);
+//}
+//... every thread offers its share of the stream to partial[thread]
+//for (size_t i = 1; i < threads; i++) {
+//	partial[0].Merge(std::move(partial[i]));
+//}
+//std::vector<double> smallest = partial[0].Take();
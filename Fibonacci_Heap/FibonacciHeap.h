@@ -0,0 +1,386 @@
+//**************************************************************************************
+//								< Fibonacci Heap >
+//**************************************************************************************
+// Type:		Lazy forest of heap-ordered trees
+// Purpose:		Priority queue
+// Name:		Fibonacci heap
+// Implementation details:
+//		> Roots and siblings are kept in circular doubly linked lists.
+//		> Consolidation is deferred until Pop, cuts cascade through marked parents.
+//		> Push, Meld and DecreaseKey are O(1) amortized, Pop and Erase O(log n).
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+template<typename T>
+class FibonacciHeap
+{
+public:
+	class Node;
+	// Stays valid until its value is popped or erased.
+	typedef const Node* Handle;
+
+private:
+	Node* min = nullptr;
+	size_t size = 0;
+	std::vector<Node*> degrees;		// consolidation buckets, kept between pops
+
+public:
+	FibonacciHeap() = default;
+	FibonacciHeap(FibonacciHeap&& heap)
+	{
+		Swap(heap);
+	}
+	FibonacciHeap& operator=(FibonacciHeap&& heap)
+	{
+		Swap(heap);
+		return *this;
+	}
+	~FibonacciHeap()
+	{
+		Clear();
+	}
+
+public:
+	FibonacciHeap(const FibonacciHeap& heap) = delete;
+	FibonacciHeap& operator=(const FibonacciHeap& heap) = delete;
+
+public:
+	Handle Push(const T& value)
+		{ return insert(new Node(value)); }
+	Handle Push(T&& value)
+		{ return insert(new Node(std::move(value))); }
+	template<typename... Args>
+	Handle Emplace(Args&&... args)
+		{ return insert(new Node(std::forward<Args>(args)...)); }
+
+	void Pop();
+	T PopValue();
+	const T& First() const
+		{ return min->value; }
+	const T& Top() const
+		{ return First(); }
+
+	void Meld(FibonacciHeap&& heap);
+	void DecreaseKey(Handle handle, const T& value)
+		{ decreaseKey(handle, value); }
+	void DecreaseKey(Handle handle, T&& value)
+		{ decreaseKey(handle, std::move(value)); }
+	void Erase(Handle handle);
+	void Clear();
+
+	bool Empty() const
+		{ return size == 0; }
+	size_t Size() const
+		{ return size; }
+
+	void Swap(FibonacciHeap& heap)
+	{
+		std::swap(min, heap.min);
+		std::swap(size, heap.size);
+		std::swap(degrees, heap.degrees);
+	}
+
+private:
+	Handle insert(Node* node);
+	template<typename Value>
+	void decreaseKey(Handle handle, Value&& value);
+	void splice(Node* first, Node* second);
+	void unlink(Node* node);
+	void link(Node* parent, Node* child);
+	void consolidate();
+	void cut(Node* node);
+	void cascadingCut(Node* node);
+};
+
+template<typename T>
+class FibonacciHeap<T>::Node
+{
+	friend class FibonacciHeap<T>;
+private:
+	T value;
+	unsigned int degree = 0;
+	bool marked = false;
+
+	Node* parent	= nullptr;
+	Node* child		= nullptr;
+	Node* left		= this;
+	Node* right		= this;
+
+public:
+	template<typename... Args>
+	explicit Node(Args&&... args)
+		: value(std::forward<Args>(args)...)
+	{
+	}
+
+public:
+	Node(const Node& node) = delete;
+	Node& operator=(const Node& node) = delete;
+
+public:
+	const T& Value() const
+		{ return value; }
+	bool isRoot() const
+		{ return parent == nullptr; }
+};
+
+// Joins two circular lists.
+template<typename T>
+inline void FibonacciHeap<T>::splice(Node* first, Node* second)
+{
+	Node* firstRight = first->right;
+	Node* secondLeft = second->left;
+	first->right = second;
+	second->left = first;
+	secondLeft->right = firstRight;
+	firstRight->left = secondLeft;
+}
+
+// Takes a node out of its circular list, leaving it a single-node list.
+template<typename T>
+inline void FibonacciHeap<T>::unlink(Node* node)
+{
+	node->left->right = node->right;
+	node->right->left = node->left;
+	node->left = node->right = node;
+}
+
+template<typename T>
+inline typename FibonacciHeap<T>::Handle FibonacciHeap<T>::insert(Node* node)
+{
+	if (min == nullptr) {
+		min = node;
+	}
+	else
+	{
+		splice(min, node);
+		if (node->value < min->value) {
+			min = node;
+		}
+	}
+	size++;
+	return node;
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::link(Node* parent, Node* child)
+{
+	unlink(child);
+	child->parent = parent;
+	child->marked = false;
+	if (parent->child == nullptr) {
+		parent->child = child;
+	} else {
+		splice(parent->child, child);
+	}
+	parent->degree++;
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::consolidate()
+{
+	size_t count = 0;
+	Node* node = min;
+	do {
+		count++;
+		node = node->right;
+	} while (node != min);
+
+	// linking only detaches roots already visited, so next stays in the ring
+	std::fill(degrees.begin(), degrees.end(), nullptr);
+	Node* next = min;
+	for (size_t i = 0; i < count; i++)
+	{
+		Node* root = next;
+		next = next->right;
+
+		unsigned int degree = root->degree;
+		while (degree < degrees.size() && degrees[degree] != nullptr)
+		{
+			Node* other = degrees[degree];
+			if (other->value < root->value) {
+				std::swap(root, other);
+			}
+			link(root, other);
+			degrees[degree] = nullptr;
+			degree++;
+		}
+		if (degree >= degrees.size()) {
+			degrees.resize(degree + 1, nullptr);
+		}
+		degrees[degree] = root;
+	}
+
+	min = nullptr;
+	for (Node* root : degrees)
+	{
+		if (root && (min == nullptr || root->value < min->value)) {
+			min = root;
+		}
+	}
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::Pop()
+{
+	if (min == nullptr) {
+		throw std::runtime_error("FibonacciHeap is empty.");
+	}
+	Node* top = min;
+
+	// children become roots
+	if (top->child)
+	{
+		Node* child = top->child;
+		do {
+			child->parent = nullptr;
+			child->marked = false;
+			child = child->right;
+		} while (child != top->child);
+		splice(top, top->child);
+		top->child = nullptr;
+	}
+
+	if (top->right == top) {
+		min = nullptr;
+	}
+	else
+	{
+		min = top->right;
+		unlink(top);
+		consolidate();
+	}
+	delete top;
+	size--;
+}
+
+template<typename T>
+inline T FibonacciHeap<T>::PopValue()
+{
+	if (min == nullptr) {
+		throw std::runtime_error("FibonacciHeap is empty.");
+	}
+	T value = std::move(min->value);
+	Pop();
+	return value;
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::Meld(FibonacciHeap&& heap)
+{
+	if (&heap == this || heap.min == nullptr) {
+		return;
+	}
+	if (min == nullptr) {
+		min = heap.min;
+	}
+	else
+	{
+		splice(min, heap.min);
+		if (heap.min->value < min->value) {
+			min = heap.min;
+		}
+	}
+	size += heap.size;
+	heap.min = nullptr;
+	heap.size = 0;
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::cut(Node* node)
+{
+	Node* parent = node->parent;
+	if (parent->child == node) {
+		parent->child = (node->right == node) ? nullptr : node->right;
+	}
+	unlink(node);
+	parent->degree--;
+
+	node->parent = nullptr;
+	node->marked = false;
+	splice(min, node);
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::cascadingCut(Node* node)
+{
+	while (node->parent != nullptr)
+	{
+		if (!node->marked)
+		{
+			node->marked = true;
+			return;
+		}
+		Node* parent = node->parent;
+		cut(node);
+		node = parent;
+	}
+}
+
+template<typename T>
+template<typename Value>
+inline void FibonacciHeap<T>::decreaseKey(Handle handle, Value&& value)
+{
+	Node* node = const_cast<Node*>(handle);
+	if (node->value < value) {
+		throw std::runtime_error("DecreaseKey failed: new value is greater than the current one.");
+	}
+	node->value = std::forward<Value>(value);
+
+	Node* parent = node->parent;
+	if (parent && node->value < parent->value)
+	{
+		cut(node);
+		cascadingCut(parent);
+	}
+	if (node->value < min->value) {
+		min = node;
+	}
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::Erase(Handle handle)
+{
+	Node* node = const_cast<Node*>(handle);
+	Node* parent = node->parent;
+	if (parent)
+	{
+		cut(node);
+		cascadingCut(parent);
+	}
+	// the node is a root now, popping it as the minimum removes it
+	min = node;
+	Pop();
+}
+
+template<typename T>
+inline void FibonacciHeap<T>::Clear()
+{
+	if (min == nullptr) {
+		return;
+	}
+	// open the root ring into a chain, child rings are spliced into it as we go
+	Node* chain = min;
+	chain->left->right = nullptr;
+	while (chain != nullptr)
+	{
+		Node* node = chain;
+		chain = node->right;
+		if (node->child)
+		{
+			Node* child = node->child;
+			child->left->right = chain;
+			chain = child;
+		}
+		delete node;
+	}
+	min = nullptr;
+	size = 0;
+}
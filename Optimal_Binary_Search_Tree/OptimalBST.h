@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <climits>
 #include <numeric>
 #include <vector>
 #include <functional>
+#include <stdexcept>
+#include "../Binary_Tree_Nodes/TreeNodes.h"
 
 
 template<typename K, typename T>
@@ -14,6 +17,7 @@ public:
 
 private:
 	Node* root = nullptr;
+	size_t rotations = 0;
 
 public:
 	OptimalBST() = default;
@@ -22,7 +26,7 @@ public:
 	{
 	}
 	~OptimalBST() {
-		delete root;
+		Clear();
 	}
 
 public:
@@ -31,11 +35,16 @@ public:
 
 public:
 	Node* Find(const K& key);
+	void Clear();
 	Node* Root() {
 		return root;
 	}
 
 	unsigned int Cost(Node* node);
+	unsigned int Depth(const Node* node) const;
+	size_t Rotations() const {
+		return rotations;
+	}
 
 	template<typename Func>
 	void InOrder(Node* _root, Func func);
@@ -58,6 +67,7 @@ template<typename K, typename T>
 class OptimalBST<K,T>::Node
 {
 	friend class OptimalBST<K,T>;
+	friend struct TreeNodes<Node>;
 private:
 	K key;
 	T* data = nullptr;
@@ -80,17 +90,6 @@ public:
 	}
 	~Node()
 	{
-		if (parent)
-		{
-			if (this->isLeftChild()) {
-				parent->left = nullptr;
-			}
-			else if (this->isRightChild()) {
-				parent->right = nullptr;
-			}
-		}
-		delete left;
-		delete right;
 		delete data;
 	}
 
@@ -162,6 +161,7 @@ template<typename K, typename T>
 inline void OptimalBST<K,T>::RotateLeft(Node* node)
 {
 	Node* pivot = node->right;
+	rotations++;
 	pivot->parent = node->parent; 
 	if (!node->isRoot()) 
 	{
@@ -187,6 +187,7 @@ template<typename K, typename T>
 inline void OptimalBST<K,T>::RotateRight(Node* node)
 {
 	Node* pivot = node->left;
+	rotations++;
 	pivot->parent = node->parent; 
 	if (!node->isRoot())
 	{
@@ -391,3 +392,15 @@ unsigned int OptimalBST<K,T>::Cost(Node* node)
 	}
 }
 
+template<typename K, typename T>
+void OptimalBST<K,T>::Clear()
+{
+	TreeNodes<Node>::Clear(root);
+	root = nullptr;
+}
+
+template<typename K, typename T>
+unsigned int OptimalBST<K,T>::Depth(const Node* node) const
+{
+	return TreeNodes<Node>::Depth(node);
+}
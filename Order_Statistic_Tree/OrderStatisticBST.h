@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include "../Binary_Tree_Nodes/TreeNodes.h"
+
 template<typename K, typename T>
 class OrderStatisticBST
 {
@@ -26,7 +28,7 @@ public:
 	OrderStatisticBST()	
 		{	}
 	~OrderStatisticBST()	
-		{ delete root; }
+		{ Clear(); }
 
 public:
 	OrderStatisticBST(const OrderStatisticBST& tree)			= delete;
@@ -38,6 +40,7 @@ public:
 
 	Node* Find(const K& key);
 	Node* FindByRank(Node* _root, int rank);
+	void Clear();
 
 	Node* Root()
 		{ return root; }
@@ -65,6 +68,7 @@ private:
 	Node* MaxNode(Node* _root);
 	Node* Find(const K& key, Node* _root);
 
+	void Discount(Node* node);
 	void DeleteCase1(Node* node);
 	void DeleteCase2(Node* node);
 	void DeleteCase3(Node* node);
@@ -77,6 +81,7 @@ template<typename K, typename T>
 class OrderStatisticBST<K,T>::Node
 {
 	friend class OrderStatisticBST<K,T>;
+	friend struct TreeNodes<Node>;
 private:
 	K key;
 	T* data			= nullptr;
@@ -94,24 +99,6 @@ public:
 	}
 	~Node()
 	{
-		if (parent)
-		{
-			if (this->isLeftChild()) {
-				parent->left = nullptr;
-			}
-			else if (this->isRightChild()) {
-				parent->right = nullptr;
-			}
-
-			while (parent != nullptr)
-			{
-				parent->size--;
-				parent = parent->parent;
-			}
-		}
-
-		delete left;
-		delete right;
 		delete data;
 	}
 
@@ -160,6 +147,7 @@ private:
 
 	void MoveTo(Node* node)
 	{
+		delete node->data;
 		node->key = key;
 		node->data = data;
 		data = nullptr;
@@ -299,12 +287,14 @@ inline void OrderStatisticBST<K,T>::Erase(const K& key)
 	// case if target is a leaf node
 	if (target->isLeaf())
 	{
+		Discount(target);
 		if (target->isBlack()) {
 			DeleteCase1(target);
 		}
 		if (target->isRoot()) {
 			root = nullptr;
 		} 
+		TreeNodes<Node>::Detach(target);
 		delete target;
 		return;
 	}
@@ -317,6 +307,7 @@ inline void OrderStatisticBST<K,T>::Erase(const K& key)
 		node->hasLeftChild() ? node->left : node->right;
 	
 	node->MoveTo(target);
+	Discount(node);
 	node->ReplaceIfNotNull(child);
 
 	if (node->isBlack())
@@ -329,6 +320,7 @@ inline void OrderStatisticBST<K,T>::Erase(const K& key)
 			DeleteCase1(child);
 		}
 	}
+	TreeNodes<Node>::Detach(node);
 	delete node;
 }
 
@@ -355,6 +347,24 @@ inline OrderStatisticNode<K,T>* OrderStatisticBST<K, T>::FindByRank(Node* _root,
 	}
 }
 
+template<typename K, typename T>
+inline void OrderStatisticBST<K,T>::Clear()
+{
+	TreeNodes<Node>::Clear(root);
+	root = nullptr;
+}
+
+// Removes node from its ancestors' sizes before the delete fix-up, so the
+// rotations done there already see the final sizes.
+template<typename K, typename T>
+inline void OrderStatisticBST<K,T>::Discount(Node* node)
+{
+	node->size = 0;
+	for (Node* parent = node->parent; parent != nullptr; parent = parent->parent) {
+		parent->size--;
+	}
+}
+
 template<typename K, typename T>
 inline void OrderStatisticBST<K,T>::InsertNode(Node* node, Node*& _root, Node* root_parent)
 {
@@ -0,0 +1,289 @@
+//**************************************************************************************
+//								< Pairing Heap >
+//**************************************************************************************
+// Type:		Self-adjusting heap-ordered multiway tree
+// Purpose:		Priority queue
+// Name:		Pairing heap
+// Implementation details:
+//		> Left-child / right-sibling layout, prev points to the previous sibling
+//		  or to the parent for the first child.
+//		> Pop combines the children with the iterative two-pass pairing.
+//		> Push, Meld and DecreaseKey are O(1), Pop and Erase O(log n) amortized.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <utility>
+#include <stdexcept>
+
+template<typename T>
+class PairingHeap
+{
+public:
+	class Node;
+	// Stays valid until its value is popped or erased.
+	typedef const Node* Handle;
+
+private:
+	Node* root = nullptr;
+	size_t size = 0;
+
+public:
+	PairingHeap() = default;
+	PairingHeap(PairingHeap&& heap)
+	{
+		Swap(heap);
+	}
+	PairingHeap& operator=(PairingHeap&& heap)
+	{
+		Swap(heap);
+		return *this;
+	}
+	~PairingHeap()
+	{
+		Clear();
+	}
+
+public:
+	PairingHeap(const PairingHeap& heap) = delete;
+	PairingHeap& operator=(const PairingHeap& heap) = delete;
+
+public:
+	Handle Push(const T& value)
+		{ return insert(new Node(value)); }
+	Handle Push(T&& value)
+		{ return insert(new Node(std::move(value))); }
+	template<typename... Args>
+	Handle Emplace(Args&&... args)
+		{ return insert(new Node(std::forward<Args>(args)...)); }
+
+	void Pop();
+	T PopValue();
+	const T& First() const
+		{ return root->value; }
+	const T& Top() const
+		{ return First(); }
+
+	void Meld(PairingHeap&& heap);
+	void DecreaseKey(Handle handle, const T& value)
+		{ decreaseKey(handle, value); }
+	void DecreaseKey(Handle handle, T&& value)
+		{ decreaseKey(handle, std::move(value)); }
+	void Erase(Handle handle);
+	void Clear();
+
+	bool Empty() const
+		{ return size == 0; }
+	size_t Size() const
+		{ return size; }
+
+	void Swap(PairingHeap& heap)
+	{
+		std::swap(root, heap.root);
+		std::swap(size, heap.size);
+	}
+
+private:
+	Handle insert(Node* node);
+	template<typename Value>
+	void decreaseKey(Handle handle, Value&& value);
+	Node* link(Node* first, Node* second);
+	Node* combine(Node* first);
+	void cut(Node* node);
+};
+
+template<typename T>
+class PairingHeap<T>::Node
+{
+	friend class PairingHeap<T>;
+private:
+	T value;
+
+	Node* child		= nullptr;
+	Node* sibling	= nullptr;
+	Node* prev		= nullptr;
+
+public:
+	template<typename... Args>
+	explicit Node(Args&&... args)
+		: value(std::forward<Args>(args)...)
+	{
+	}
+
+public:
+	Node(const Node& node) = delete;
+	Node& operator=(const Node& node) = delete;
+
+public:
+	const T& Value() const
+		{ return value; }
+	bool isRoot() const
+		{ return prev == nullptr; }
+};
+
+template<typename T>
+inline typename PairingHeap<T>::Handle PairingHeap<T>::insert(Node* node)
+{
+	root = link(root, node);
+	size++;
+	return node;
+}
+
+// Links two detached trees, the greater root becomes the first child of the other.
+template<typename T>
+inline typename PairingHeap<T>::Node* PairingHeap<T>::link(Node* first, Node* second)
+{
+	if (first == nullptr) {
+		return second;
+	}
+	if (second == nullptr) {
+		return first;
+	}
+	if (second->value < first->value) {
+		std::swap(first, second);
+	}
+	second->sibling = first->child;
+	if (first->child) {
+		first->child->prev = second;
+	}
+	second->prev = first;
+	first->child = second;
+	return first;
+}
+
+// Two-pass pairing of a sibling list: pairs are linked left to right and
+// stacked, then the stack is folded back into a single tree.
+template<typename T>
+inline typename PairingHeap<T>::Node* PairingHeap<T>::combine(Node* first)
+{
+	Node* pairs = nullptr;
+	while (first != nullptr)
+	{
+		Node* a = first;
+		Node* b = a->sibling;
+		first = b ? b->sibling : nullptr;
+
+		a->prev = a->sibling = nullptr;
+		if (b) {
+			b->prev = b->sibling = nullptr;
+		}
+		Node* pair = link(a, b);
+		pair->sibling = pairs;
+		pairs = pair;
+	}
+
+	Node* result = nullptr;
+	while (pairs != nullptr)
+	{
+		Node* next = pairs->sibling;
+		pairs->sibling = nullptr;
+		result = link(result, pairs);
+		pairs = next;
+	}
+	return result;
+}
+
+template<typename T>
+inline void PairingHeap<T>::cut(Node* node)
+{
+	if (node->prev->child == node) {
+		node->prev->child = node->sibling;
+	} else {
+		node->prev->sibling = node->sibling;
+	}
+	if (node->sibling) {
+		node->sibling->prev = node->prev;
+	}
+	node->prev = node->sibling = nullptr;
+}
+
+template<typename T>
+inline void PairingHeap<T>::Pop()
+{
+	if (root == nullptr) {
+		throw std::runtime_error("PairingHeap is empty.");
+	}
+	Node* top = root;
+	root = combine(top->child);
+	delete top;
+	size--;
+}
+
+template<typename T>
+inline T PairingHeap<T>::PopValue()
+{
+	if (root == nullptr) {
+		throw std::runtime_error("PairingHeap is empty.");
+	}
+	T value = std::move(root->value);
+	Pop();
+	return value;
+}
+
+template<typename T>
+inline void PairingHeap<T>::Meld(PairingHeap&& heap)
+{
+	if (&heap == this) {
+		return;
+	}
+	root = link(root, heap.root);
+	size += heap.size;
+	heap.root = nullptr;
+	heap.size = 0;
+}
+
+template<typename T>
+template<typename Value>
+inline void PairingHeap<T>::decreaseKey(Handle handle, Value&& value)
+{
+	Node* node = const_cast<Node*>(handle);
+	if (node->value < value) {
+		throw std::runtime_error("DecreaseKey failed: new value is greater than the current one.");
+	}
+	node->value = std::forward<Value>(value);
+	if (node != root)
+	{
+		cut(node);
+		root = link(root, node);
+	}
+}
+
+template<typename T>
+inline void PairingHeap<T>::Erase(Handle handle)
+{
+	Node* node = const_cast<Node*>(handle);
+	if (node == root) {
+		Pop();
+		return;
+	}
+	cut(node);
+	root = link(root, combine(node->child));
+	delete node;
+	size--;
+}
+
+template<typename T>
+inline void PairingHeap<T>::Clear()
+{
+	// rotating first children up turns the tree into a sibling chain
+	Node* node = root;
+	while (node != nullptr)
+	{
+		if (node->child)
+		{
+			Node* child = node->child;
+			node->child = child->sibling;
+			child->sibling = node;
+			node = child;
+		}
+		else
+		{
+			Node* next = node->sibling;
+			delete node;
+			node = next;
+		}
+	}
+	root = nullptr;
+	size = 0;
+}
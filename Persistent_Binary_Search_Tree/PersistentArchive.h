@@ -0,0 +1,343 @@
+//**************************************************************************************
+//								< Persistent Archive >
+//**************************************************************************************
+// Type:		Binary snapshot of PersistentBST versions
+// Purpose:		Storing and reloading a version history with its structural sharing
+// Name:		Persistent archive
+// Implementation details:
+//		> Save writes every distinct node of the given versions once, children before
+//		  parents, as a fixed-size record { key, data, left id, right id }. Ids are
+//		  record numbers starting at 1, 0 stands for an empty subtree. The version
+//		  root ids follow the records.
+//		> Loading works on a buffer holding the whole archive, typically a read-only
+//		  file mapping (mmap, MapViewOfFile), which the caller owns and keeps alive.
+//		  Opening only checks the header, records are decoded when they are reached:
+//		  Find answers a lookup on any version straight from the buffer, Load builds
+//		  a version reusing every node already built, so the loaded versions share
+//		  nodes exactly as the saved ones did.
+//		> K and T are stored as raw bytes in native byte order, so they have to be
+//		  trivially copyable and the archive is only portable between like machines.
+//		> A child id is always smaller than its parent's, which Find and Load check,
+//		  so a damaged archive makes them throw instead of looping.
+//		> Load also checks every node it builds: the AVL balance of its subtrees and
+//		  the keys of its neighbours in order. Find checks each key against the range
+//		  of the walk so far and the walk against the height of an AVL tree. A damaged
+//		  archive thus never yields an unordered or unbalanced version.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include "PersistentBST.h"
+
+template<typename K, typename T, typename RefCount = AtomicRefCount>
+class PersistentArchive
+{
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<T>::value,
+		"PersistentArchive stores raw bytes: K and T must be trivially copyable.");
+
+public:
+	typedef PersistentBST<K, T, RefCount> Tree;
+	typedef typename Tree::NodePtr NodePtr;
+	typedef typename Tree::Node Node;
+
+private:
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t format;
+		std::uint32_t recordBytes;
+		std::uint64_t nodes;
+		std::uint64_t versions;
+	};
+	static const std::uint32_t Format = 1;
+	static const size_t KeyOffset	= 0;
+	static const size_t DataOffset	= sizeof(K);
+	static const size_t LeftOffset	= sizeof(K) + sizeof(T);
+	static const size_t RightOffset	= LeftOffset + sizeof(std::uint64_t);
+	static const size_t RecordBytes	= RightOffset + sizeof(std::uint64_t);
+
+	const char* buffer;
+	std::uint64_t nodes;
+	std::uint64_t versions;
+	std::vector<NodePtr> built;		// by id, filled by Load
+
+public:
+	// data has to stay valid and unchanged while the archive is used.
+	PersistentArchive(const void* data, size_t bytes);
+
+public:
+	PersistentArchive(const PersistentArchive& archive) = delete;
+	PersistentArchive& operator=(const PersistentArchive& archive) = delete;
+
+public:
+	// Writes versions with their shared nodes stored once.
+	static void Save(std::FILE* file, const std::vector<Tree>& versions);
+
+	size_t Versions() const
+		{ return static_cast<size_t>(versions); }
+	size_t Nodes() const
+		{ return static_cast<size_t>(nodes); }
+
+	// Builds the version, sharing nodes with the versions loaded before.
+	Tree Load(size_t version);
+	// Copies the data of key in the version into data, false if the key is absent.
+	bool Find(size_t version, const K& key, T& data) const;
+	// Drops the built nodes, the loaded versions keep theirs alive.
+	void Forget()
+		{ std::vector<NodePtr>().swap(built); }
+
+private:
+	static void write(std::FILE* file, const void* data, size_t bytes);
+
+	const char* record(std::uint64_t id) const
+		{ return buffer + sizeof(Header) + (id - 1) * RecordBytes; }
+	template<typename Field>
+	static Field read(const char* from)
+	{
+		Field field;
+		std::memcpy(&field, from, sizeof(Field));
+		return field;
+	}
+	std::uint64_t root(size_t version) const;
+	std::uint64_t child(std::uint64_t id, size_t offset) const;
+	static void check(const K& key, const NodePtr& left, const NodePtr& right);
+};
+
+template<typename K, typename T, typename RefCount>
+inline PersistentArchive<K, T, RefCount>::PersistentArchive(const void* data, size_t bytes)
+	: buffer{ static_cast<const char*>(data) }
+{
+	if (bytes < sizeof(Header)) {
+		throw std::runtime_error("PersistentArchive error: the archive is truncated.");
+	}
+	Header header = read<Header>(buffer);
+	if (std::memcmp(header.magic, "PBSTDAG", 8) != 0 || header.format != Format) {
+		throw std::runtime_error("PersistentArchive error: not a PersistentBST archive.");
+	}
+	if (header.recordBytes != RecordBytes) {
+		throw std::runtime_error("PersistentArchive error: the archive holds other key or data types.");
+	}
+	nodes = header.nodes;
+	versions = header.versions;
+	size_t available = bytes - sizeof(Header);
+	if (nodes > available / RecordBytes ||
+		versions > (available - nodes * RecordBytes) / sizeof(std::uint64_t)) {
+		throw std::runtime_error("PersistentArchive error: the archive is truncated.");
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+inline void PersistentArchive<K, T, RefCount>::write(std::FILE* file, const void* data, size_t bytes)
+{
+	if (std::fwrite(data, 1, bytes, file) != bytes) {
+		throw std::runtime_error("PersistentArchive error: cannot write the archive.");
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+inline void PersistentArchive<K, T, RefCount>::Save(std::FILE* file, const std::vector<Tree>& versions)
+{
+	// number the nodes in post-order, a node shared by several versions only once
+	std::unordered_map<const Node*, std::uint64_t> ids;
+	std::vector<const Node*> order;
+	std::vector<const Node*> pending;
+	for (const Tree& version : versions)
+	{
+		if (version.root) {
+			pending.push_back(version.root.get());
+		}
+		while (!pending.empty())
+		{
+			const Node* node = pending.back();
+			if (ids.count(node) != 0)
+			{
+				pending.pop_back();
+				continue;
+			}
+			bool ready = true;
+			for (const Node* next : { node->right.get(), node->left.get() })
+			{
+				if (next != nullptr && ids.count(next) == 0)
+				{
+					pending.push_back(next);
+					ready = false;
+				}
+			}
+			if (ready)
+			{
+				pending.pop_back();
+				order.push_back(node);
+				ids.emplace(node, order.size());
+			}
+		}
+	}
+
+	Header header = { { 'P', 'B', 'S', 'T', 'D', 'A', 'G', 0 }, Format, RecordBytes, order.size(), versions.size() };
+	write(file, &header, sizeof(Header));
+	char bytes[RecordBytes];
+	for (const Node* node : order)
+	{
+		std::uint64_t left = node->left ? ids[node->left.get()] : 0;
+		std::uint64_t right = node->right ? ids[node->right.get()] : 0;
+		std::memcpy(bytes + KeyOffset, &node->key, sizeof(K));
+		std::memcpy(bytes + DataOffset, &node->data, sizeof(T));
+		std::memcpy(bytes + LeftOffset, &left, sizeof(left));
+		std::memcpy(bytes + RightOffset, &right, sizeof(right));
+		write(file, bytes, RecordBytes);
+	}
+	for (const Tree& version : versions)
+	{
+		std::uint64_t id = version.root ? ids[version.root.get()] : 0;
+		write(file, &id, sizeof(id));
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+inline std::uint64_t PersistentArchive<K, T, RefCount>::root(size_t version) const
+{
+	if (version >= versions) {
+		throw std::runtime_error("PersistentArchive error: no such version.");
+	}
+	std::uint64_t id = read<std::uint64_t>(record(nodes + 1) + version * sizeof(std::uint64_t));
+	if (id > nodes) {
+		throw std::runtime_error("PersistentArchive error: the archive is damaged.");
+	}
+	return id;
+}
+
+template<typename K, typename T, typename RefCount>
+inline std::uint64_t PersistentArchive<K, T, RefCount>::child(std::uint64_t id, size_t offset) const
+{
+	std::uint64_t next = read<std::uint64_t>(record(id) + offset);
+	if (next >= id) {
+		throw std::runtime_error("PersistentArchive error: the archive is damaged.");
+	}
+	return next;
+}
+
+// Throws unless key with the subtrees left and right makes an ordered, balanced node.
+template<typename K, typename T, typename RefCount>
+inline void PersistentArchive<K, T, RefCount>::check(const K& key, const NodePtr& left, const NodePtr& right)
+{
+	unsigned int leftHeight = Tree::Height(left);
+	unsigned int rightHeight = Tree::Height(right);
+	bool valid = leftHeight <= rightHeight + 1 && rightHeight <= leftHeight + 1;
+	if (valid && left)
+	{
+		// the subtrees were checked when they were built, so these walks are short
+		const Node* previous = left.get();
+		while (previous->right) {
+			previous = previous->right.get();
+		}
+		valid = previous->key < key;
+	}
+	if (valid && right)
+	{
+		const Node* next = right.get();
+		while (next->left) {
+			next = next->left.get();
+		}
+		valid = key < next->key;
+	}
+	if (!valid) {
+		throw std::runtime_error("PersistentArchive error: the archive is damaged.");
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+inline bool PersistentArchive<K, T, RefCount>::Find(size_t version, const K& key, T& data) const
+{
+	std::uint64_t id = root(version);
+	// keys passed on the way down bound the current one, from below or above
+	const char* lower = nullptr;
+	const char* upper = nullptr;
+	for (size_t depth = 0; id != 0; depth++)
+	{
+		K current = read<K>(record(id) + KeyOffset);
+		if (depth == Tree::MaxHeight ||
+			(lower != nullptr && !(read<K>(lower) < current)) ||
+			(upper != nullptr && !(current < read<K>(upper)))) {
+			throw std::runtime_error("PersistentArchive error: the archive is damaged.");
+		}
+		if (current < key) {
+			lower = record(id) + KeyOffset;
+			id = child(id, RightOffset);
+		}
+		else if (key < current) {
+			upper = record(id) + KeyOffset;
+			id = child(id, LeftOffset);
+		}
+		else
+		{
+			data = read<T>(record(id) + DataOffset);
+			return true;
+		}
+	}
+	return false;
+}
+
+template<typename K, typename T, typename RefCount>
+inline typename PersistentArchive<K, T, RefCount>::Tree PersistentArchive<K, T, RefCount>::Load(size_t version)
+{
+	std::uint64_t id = root(version);
+	if (built.empty()) {
+		built.resize(static_cast<size_t>(nodes) + 1);
+	}
+	// children are built before their parents, built[0] stays the empty subtree
+	std::vector<std::uint64_t> pending;
+	if (id != 0 && !built[id]) {
+		pending.push_back(id);
+	}
+	while (!pending.empty())
+	{
+		std::uint64_t current = pending.back();
+		std::uint64_t left = child(current, LeftOffset);
+		std::uint64_t right = child(current, RightOffset);
+		bool ready = true;
+		for (std::uint64_t next : { right, left })
+		{
+			if (next != 0 && !built[next])
+			{
+				pending.push_back(next);
+				ready = false;
+			}
+		}
+		if (!ready) {
+			continue;
+		}
+		pending.pop_back();
+		if (!built[current])
+		{
+			K key = read<K>(record(current) + KeyOffset);
+			check(key, built[left], built[right]);
+			built[current] = Tree::NewNode(key, read<T>(record(current) + DataOffset), built[left], built[right]);
+		}
+	}
+	return Tree(built[id]);
+}
+
+// Usage example
+//typedef PersistentBST<unsigned int, double> Tree;
+//std::vector<Tree> history = ...;		// e.g. one version per day
+//std::FILE* file = std::fopen("history.bin", "wb");
+//PersistentArchive<unsigned int, double>::Save(file, history);
+//std::fclose(file);
+//...after a restart, with the file mapped read-only:
+//int descriptor = open("history.bin", O_RDONLY);
+//struct stat status;
+//fstat(descriptor, &status);
+//void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+//PersistentArchive<unsigned int, double> archive(data, status.st_size);
+//double price;
+//if (archive.Find(archive.Versions() - 1, 42, price)) {
+//	std::cout << price;
+//}
+//Tree yesterday = archive.Load(archive.Versions() - 2);
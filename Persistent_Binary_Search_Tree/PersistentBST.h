@@ -1,14 +1,188 @@
 #pragma once
 
-#include <memory>
-#include <functional>
+#include <new>
+#include <atomic>
+#include <vector>
+#include <future>
+#include <thread>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
 
-template<typename K, typename T>
+// AVL tree with path copying: an update copies the O(log n) nodes on the search path
+// (plus at most a constant number per level for rotations), everything else is shared.
+// Nodes are reference counted intrusively and recycled through a per-thread pool.
+// A Transient applies a batch of updates in place to the nodes it created itself
+// (tagged with its edit token), Persistent() turns the result back into a version.
+// Diff walks two versions in key order and skips the subtrees they share.
+// Every node keeps its subtree size, so Select, Rank and CountRange work on any version.
+// Union, Intersection and Difference are join based: O(m log(n/m + 1)) work, untouched
+// subtrees of the inputs are shared, large halves are forked onto other threads.
+
+// Reference count policies: AtomicRefCount lets versions be shared between threads,
+// LocalRefCount drops the atomic read-modify-writes for trees used by a single thread.
+struct AtomicRefCount
+{
+	static const bool ThreadSafe = true;
+	std::atomic<unsigned int> count{ 0 };
+
+	void Increment() {
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+	// true when the last reference is gone
+	bool Decrement() {
+		return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+	}
+};
+
+struct LocalRefCount
+{
+	static const bool ThreadSafe = false;
+	unsigned int count = 0;
+
+	void Increment() {
+		count++;
+	}
+	bool Decrement() {
+		return --count == 0;
+	}
+};
+
+// Free list of node-sized slots owned by the calling thread. A node freed on another
+// thread than the one that created it joins the freeing thread's list. A list keeps at
+// most Capacity slots and hands the rest back to the heap, so a reader dropping the last
+// references to a writer's nodes does not hoard them. Once the thread's destructors have
+// emptied the list, e.g. for a static or thread_local tree destroyed late, slots go
+// straight to and from the heap.
+template<size_t Size>
+class PersistentNodePool
+{
+private:
+	struct Slot { Slot* next; };
+	// plain data: no destructor, so it stays usable after Drain has run
+	struct List
+	{
+		Slot* head;
+		size_t count;
+		bool closed;
+	};
+	struct Drain
+	{
+		List& list;
+
+		~Drain()
+		{
+			while (list.head != nullptr)
+			{
+				Slot* next = list.head->next;
+				::operator delete(list.head);
+				list.head = next;
+			}
+			list.count = 0;
+			list.closed = true;
+		}
+	};
+
+	static List& local()
+	{
+		thread_local List list = { nullptr, 0, false };
+		thread_local Drain drain{ list };	// constructed on first use, destroyed at thread exit
+		return list;
+	}
+
+public:
+	static const size_t Capacity = 1 << 12;
+
+	static void* Allocate()
+	{
+		List& list = local();
+		if (list.head == nullptr) {
+			return ::operator new(std::max(Size, sizeof(Slot)));
+		}
+		Slot* slot = list.head;
+		list.head = slot->next;
+		list.count--;
+		return slot;
+	}
+	static void Release(void* memory)
+	{
+		List& list = local();
+		if (list.closed || list.count == Capacity)
+		{
+			::operator delete(memory);
+			return;
+		}
+		list.head = new (memory) Slot{ list.head };
+		list.count++;
+	}
+};
+
+template<typename K, typename T, typename RefCount>
+class TransientBST;
+template<typename K, typename T, typename RefCount>
+class PersistentArchive;
+
+template<typename K, typename T, typename RefCount = AtomicRefCount>
 class PersistentBST
 {
+	friend class TransientBST<K, T, RefCount>;
+	friend class PersistentArchive<K, T, RefCount>;
 public:
 	class Node;
-	typedef std::shared_ptr<const Node> NodePtr;
+	// Edit token of a transient, 0 for nodes that are immutable from birth.
+	typedef unsigned long long Edit;
+	enum class Change { Inserted, Erased, Changed };
+	// Owning pointer to an immutable node, counted inside the node itself.
+	class NodePtr
+	{
+		friend class PersistentBST<K,T,RefCount>;
+	private:
+		const Node* node = nullptr;
+
+		explicit NodePtr(const Node* _node)
+			: node{ _node }
+		{
+			node->references.Increment();
+		}
+
+	public:
+		NodePtr() = default;
+		NodePtr(std::nullptr_t)
+		{
+		}
+		NodePtr(const NodePtr& pointer)
+			: node{ pointer.node }
+		{
+			if (node) {
+				node->references.Increment();
+			}
+		}
+		NodePtr(NodePtr&& pointer)
+			: node{ pointer.node }
+		{
+			pointer.node = nullptr;
+		}
+		NodePtr& operator=(NodePtr pointer)
+		{
+			std::swap(node, pointer.node);
+			return *this;
+		}
+		~NodePtr();
+
+	public:
+		const Node* get()			const { return node; }
+		const Node* operator->()	const { return node; }
+		const Node& operator*()		const { return *node; }
+		explicit operator bool()	const { return node != nullptr; }
+
+		friend bool operator==(const NodePtr& first, const NodePtr& second) {
+			return first.node == second.node;
+		}
+		friend bool operator!=(const NodePtr& first, const NodePtr& second) {
+			return first.node != second.node;
+		}
+	};
 
 private:
 	NodePtr root = nullptr;
@@ -16,7 +190,7 @@ private:
 public:
 	PersistentBST() = default;
 	PersistentBST(NodePtr _root)
-		: root{ _root }
+		: root{ std::move(_root) }
 	{
 	}
 
@@ -30,106 +204,861 @@ public:
 	NodePtr Find(const K& key) const {
 		return Find(root, key);
 	}
+	TransientBST<K, T, RefCount> Transient() const {
+		return TransientBST<K, T, RefCount>(root);
+	}
 
-	bool Empty() const { 
+	bool Empty() const {
 		return root == nullptr;
 	}
+	size_t Size() const {
+		return Size(root);
+	}
+
+	// Node with the k-th smallest key, 1-based as in OrderStatisticBST, nullptr if k is
+	// out of range.
+	NodePtr Select(size_t k) const;
+	// Number of keys not greater than key: the position of key if it is present.
+	size_t Rank(const K& key) const {
+		return Count(root, key, true);
+	}
+	// Number of keys in [low, high].
+	size_t CountRange(const K& low, const K& high) const {
+		return (high < low) ? 0 : Count(root, high, true) - Count(root, low, false);
+	}
+
+	// Calls callback(change, before, after) in key order for every key whose presence or
+	// data (compared with ==) differs, before or after being nullptr for inserted and
+	// erased keys. Shared subtrees are skipped: O(changes * log n) for related versions.
+	template<typename Callback>
+	static void Diff(const PersistentBST& from, const PersistentBST& to, Callback callback);
+
+	// Keys of both trees, the data of second wins for keys in both.
+	static PersistentBST Union(const PersistentBST& first, const PersistentBST& second) {
+		return PersistentBST(Union(first.root, second.root, Forks()));
+	}
+	// Keys of both trees with the data of first.
+	static PersistentBST Intersection(const PersistentBST& first, const PersistentBST& second) {
+		return PersistentBST(Intersection(first.root, second.root, Forks()));
+	}
+	// Keys of first that are not in second.
+	static PersistentBST Difference(const PersistentBST& first, const PersistentBST& second) {
+		return PersistentBST(Difference(first.root, second.root, Forks()));
+	}
+
+private:
+	// In-order walk state: a subtree still to expand, or a single node next in order.
+	struct DiffItem
+	{
+		const Node* node;
+		bool single;
+	};
+	static void Expand(std::vector<DiffItem>& stack);
+
+	// Updates walk down once, recording the slots of the search path in a stack buffer,
+	// and copy the path bottom-up: no recursion and no allocation besides the new nodes.
+	// An AVL tree of height 93 would need more than 2^64 nodes.
+	static const size_t MaxHeight = 92;
+	// Appends slot to the path, throwing on a deeper tree than any AVL tree can be.
+	static void Record(const NodePtr** path, size_t& depth, const NodePtr* slot) {
+		if (depth == MaxHeight) {
+			throw std::runtime_error("PersistentBST error: the tree is not balanced.");
+		}
+		path[depth++] = slot;
+	}
+
+	static NodePtr Insert(const NodePtr& root, const K& key, const T& data);
+	static NodePtr Erase(const NodePtr& root, const K& key);
+	static NodePtr Find(const NodePtr& root, const K& key);
+	static NodePtr Rebuild(const NodePtr* const* path, size_t begin, size_t end, const NodePtr* slot, NodePtr subtree);
+
+	static unsigned int Height(const NodePtr& node) {
+		return node ? node->height : 0;
+	}
+	static size_t Size(const NodePtr& node) {
+		return node ? node->size : 0;
+	}
+	// Number of keys less than key, or not greater than it if inclusive.
+	static size_t Count(const NodePtr& root, const K& key, bool inclusive);
+	template<typename... Args>
+	static NodePtr NewNode(Args&&... args);
+	static NodePtr MakeNode(const NodePtr& root, NodePtr left = nullptr, NodePtr right = nullptr) {
+		return NewNode(root->key, root->data, std::move(left), std::move(right));
+	}
+	static NodePtr Balance(const NodePtr& root, NodePtr left, NodePtr right);
+
+	// join based set operations
+	struct Parts
+	{
+		NodePtr left;
+		NodePtr middle;		// the node with the split key, if any
+		NodePtr right;
+	};
+	static const unsigned int ForkHeight = 12;	// smaller subtrees are not worth a task
+
+	static NodePtr Join(NodePtr left, const NodePtr& middle, NodePtr right);
+	static NodePtr JoinLeft(const NodePtr& left, const NodePtr& middle, NodePtr right);
+	static NodePtr JoinRight(NodePtr left, const NodePtr& middle, const NodePtr& right);
+	static NodePtr Join(NodePtr left, NodePtr right);
+	static NodePtr SplitLast(const NodePtr& root, NodePtr& last);
+	static Parts Split(const NodePtr& root, const K& key);
+
+	static unsigned int Forks();
+	template<typename First, typename Second>
+	static void Fork(bool parallel, First first, Second second);
+	static NodePtr Union(const NodePtr& first, const NodePtr& second, unsigned int forks);
+	static NodePtr Intersection(const NodePtr& first, const NodePtr& second, unsigned int forks);
+	static NodePtr Difference(const NodePtr& first, const NodePtr& second, unsigned int forks);
+
+	// transient updates, node is modified in place only if it carries edit
+	static Edit NewEdit();
+	static Node* Mutable(const NodePtr& node) {
+		return const_cast<Node*>(node.get());
+	}
+	static NodePtr Own(const NodePtr& node, Edit edit);
+	static void Update(Node* node) {
+		node->height = 1 + std::max(Height(node->left), Height(node->right));
+		node->size = 1 + Size(node->left) + Size(node->right);
+	}
+	static NodePtr RotateLeft(NodePtr node, Edit edit);
+	static NodePtr RotateRight(NodePtr node, Edit edit);
+	static NodePtr Rebalance(NodePtr node, Edit edit);
+	static NodePtr InsertInPlace(const NodePtr& root, const K& key, const T& data, Edit edit, bool& changed);
+	static NodePtr EraseInPlace(const NodePtr& root, const K& key, Edit edit, bool& changed);
+	static NodePtr EraseMinInPlace(const NodePtr& root, NodePtr& minNode, Edit edit);
+};
+
+// Mutable view of a version for batched updates. Nodes it creates are tagged with its
+// edit token and updated in place afterwards, shared nodes are copied once on first touch.
+template<typename K, typename T, typename RefCount>
+class TransientBST
+{
+	typedef PersistentBST<K, T, RefCount> Tree;
+	typedef typename Tree::NodePtr NodePtr;
+	typedef typename Tree::Edit Edit;
 
 private:
-	NodePtr Insert(NodePtr root, const K& key, const T& data) const;
-	NodePtr Erase(NodePtr root, const K& key) const;
-	NodePtr Find(NodePtr root, const K& key) const;
+	NodePtr root;
+	Edit edit;
+
+public:
+	explicit TransientBST(NodePtr _root)
+		: root{ std::move(_root) }, edit{ Tree::NewEdit() }
+	{
+	}
+	TransientBST(TransientBST&& transient) = default;
+	TransientBST& operator=(TransientBST&& transient) = default;
+
+public:
+	TransientBST(const TransientBST& transient) = delete;
+	TransientBST& operator=(const TransientBST& transient) = delete;
+
+public:
+	void Insert(const K& key, const T& data)
+	{
+		bool changed = false;
+		root = Tree::InsertInPlace(root, key, data, edit, changed);
+	}
+	void Erase(const K& key)
+	{
+		bool changed = false;
+		root = Tree::EraseInPlace(root, key, edit, changed);
+	}
+	// The node may still change in place with later updates of this transient.
+	NodePtr Find(const K& key) const {
+		return Tree::Find(root, key);
+	}
+	bool Empty() const {
+		return root == nullptr;
+	}
 
-	NodePtr MakeNode(NodePtr root, NodePtr left = nullptr, NodePtr right = nullptr) const {
-		return std::make_shared<const Node>(root->key, root->data, left, right);
+	// Freezes the current state into a version. The transient stays usable with a new
+	// token, so it never modifies the nodes of the returned version.
+	Tree Persistent()
+	{
+		edit = Tree::NewEdit();
+		return Tree(root);
 	}
 };
 
-template<typename K, typename T>
-class PersistentBST<K,T>::Node 
+template<typename K, typename T, typename RefCount>
+class PersistentBST<K,T,RefCount>::Node
 {
-	friend class PersistentBST<K,T>;
+	friend class PersistentBST<K,T,RefCount>;
+	friend class PersistentBST<K,T,RefCount>::NodePtr;
+	friend class PersistentArchive<K,T,RefCount>;
 private:
 	K key;
 	T data;
+	unsigned int height;
+	size_t size;		// nodes in the subtree
+	Edit edit;
+	mutable RefCount references;
 
 	NodePtr left;
 	NodePtr right;
 
 public:
-	Node(const K& _key, const T& _data, NodePtr _left = nullptr, NodePtr _right = nullptr)
-		: key{ _key }, data{ _data }, left{ _left }, right{ _right }
+	Node(const K& _key, const T& _data, NodePtr _left = nullptr, NodePtr _right = nullptr, Edit _edit = 0)
+		: key{ _key }, data{ _data }, edit{ _edit }, left{ std::move(_left) }, right{ std::move(_right) }
 	{
+		height = 1 + std::max(PersistentBST::Height(left), PersistentBST::Height(right));
+		size = 1 + PersistentBST::Size(left) + PersistentBST::Size(right);
 	}
+	Node(const Node& node) = delete;
+	Node& operator=(const Node& node) = delete;
 
 public:
 	const K& Key()	const { return key; }
 	const T& Data() const { return data; }
+	unsigned int Height() const { return height; }
+	size_t Size() const { return size; }
 };
 
-template<typename K, typename T>
-using PersistentNodePtr = typename PersistentBST<K, T>::NodePtr;
+template<typename K, typename T, typename RefCount>
+inline PersistentBST<K,T,RefCount>::NodePtr::~NodePtr()
+{
+	if (node && node->references.Decrement())
+	{
+		node->~Node();
+		PersistentNodePool<sizeof(Node)>::Release(const_cast<Node*>(node));
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+using PersistentNodePtr = typename PersistentBST<K, T, RefCount>::NodePtr;
 
-template<typename K, typename T>
-inline PersistentNodePtr<K,T> PersistentBST<K, T>::Insert(NodePtr root, const K& key, const T& data) const
+template<typename K, typename T, typename RefCount>
+template<typename... Args>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::NewNode(Args&&... args)
 {
-	if (root == nullptr) {
-		return std::make_shared<const Node>(key, data);
+	void* memory = PersistentNodePool<sizeof(Node)>::Allocate();
+	try {
+		return NodePtr(new (memory) Node(std::forward<Args>(args)...));
+	} catch (...) {
+		PersistentNodePool<sizeof(Node)>::Release(memory);
+		throw;
 	}
-	if (root->key > key) {
-		return MakeNode(root, Insert(root->left, key, data), root->right);
+}
+
+// Copies root with the given children, rotating once or twice if their heights differ by two.
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Balance(const NodePtr& root, NodePtr left, NodePtr right)
+{
+	if (Height(left) > Height(right) + 1)
+	{
+		if (Height(left->left) >= Height(left->right)) {
+			return MakeNode(left, left->left, MakeNode(root, left->right, std::move(right)));
+		}
+		const NodePtr& middle = left->right;
+		return MakeNode(middle, MakeNode(left, left->left, middle->left), MakeNode(root, middle->right, std::move(right)));
 	}
-	if (root->key < key) {
-		return MakeNode(root, root->left, Insert(root->right, key, data));
+	if (Height(right) > Height(left) + 1)
+	{
+		if (Height(right->right) >= Height(right->left)) {
+			return MakeNode(right, MakeNode(root, std::move(left), right->left), right->right);
+		}
+		const NodePtr& middle = right->left;
+		return MakeNode(middle, MakeNode(root, std::move(left), middle->left), MakeNode(right, middle->right, right->right));
+	}
+	return MakeNode(root, std::move(left), std::move(right));
+}
+
+// Replaces *slot with subtree and copies the path nodes path[begin, end) above it,
+// rebalancing each copy. path[i + 1] has to be a child slot of the node in path[i].
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Rebuild(const NodePtr* const* path, size_t begin, size_t end, const NodePtr* slot, NodePtr subtree)
+{
+	while (end > begin)
+	{
+		const NodePtr& parent = *path[--end];
+		if (slot == &parent->left) {
+			subtree = Balance(parent, std::move(subtree), parent->right);
+		} else {
+			subtree = Balance(parent, parent->left, std::move(subtree));
+		}
+		slot = path[end];
+	}
+	return subtree;
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Insert(const NodePtr& root, const K& key, const T& data)
+{
+	const NodePtr* path[MaxHeight];
+	size_t depth = 0;
+	const NodePtr* slot = &root;
+	while (*slot != nullptr)
+	{
+		const Node* node = slot->get();
+		if (node->key > key) {
+			Record(path, depth, slot);
+			slot = &node->left;
+		}
+		else if (node->key < key) {
+			Record(path, depth, slot);
+			slot = &node->right;
+		}
+		else {
+			return root;
+		}
+	}
+	return Rebuild(path, 0, depth, slot, NewNode(key, data));
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Erase(const NodePtr& root, const K& key)
+{
+	const NodePtr* path[MaxHeight];
+	size_t depth = 0;
+	const NodePtr* slot = &root;
+	while (true)
+	{
+		const Node* node = slot->get();
+		if (node == nullptr) {
+			return root;
+		}
+		if (node->key > key) {
+			Record(path, depth, slot);
+			slot = &node->left;
+		}
+		else if (node->key < key) {
+			Record(path, depth, slot);
+			slot = &node->right;
+		}
+		else {
+			break;
+		}
+	}
+	// (*slot)->key == key
+	const NodePtr& erased = *slot;
+	if (erased->left == nullptr) {
+		return Rebuild(path, 0, depth, slot, erased->right);
+	}
+	if (erased->right == nullptr) {
+		return Rebuild(path, 0, depth, slot, erased->left);
+	}
+	// erased has both children, the minimum of its right subtree takes its place
+	size_t top = depth;
+	Record(path, depth, slot);
+	const NodePtr* minSlot = &erased->right;
+	while ((*minSlot)->left != nullptr)
+	{
+		Record(path, depth, minSlot);
+		minSlot = &(*minSlot)->left;
+	}
+	const NodePtr& minNode = *minSlot;
+	NodePtr rightBranch = Rebuild(path, top + 1, depth, minSlot, minNode->right);
+	return Rebuild(path, 0, top, slot, Balance(minNode, erased->left, std::move(rightBranch)));
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Find(const NodePtr& root, const K& key)
+{
+	const Node* node = root.get();
+	while (node != nullptr)
+	{
+		if (node->key < key) {
+			node = node->right.get();
+		}
+		else if (node->key > key) {
+			node = node->left.get();
+		}
+		else {
+			return NodePtr(node);
+		}
+	}
+	return nullptr;
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Select(size_t k) const
+{
+	const Node* node = root.get();
+	while (node != nullptr)
+	{
+		size_t rank = Size(node->left) + 1;
+		if (k < rank) {
+			node = node->left.get();
+		}
+		else if (k > rank) {
+			k -= rank;
+			node = node->right.get();
+		}
+		else {
+			return NodePtr(node);
+		}
+	}
+	return nullptr;
+}
+
+template<typename K, typename T, typename RefCount>
+inline size_t PersistentBST<K, T, RefCount>::Count(const NodePtr& root, const K& key, bool inclusive)
+{
+	size_t count = 0;
+	const Node* node = root.get();
+	while (node != nullptr)
+	{
+		if (node->key < key || (inclusive && !(key < node->key))) {
+			count += Size(node->left) + 1;
+			node = node->right.get();
+		}
+		else {
+			node = node->left.get();
+		}
+	}
+	return count;
+}
+
+template<typename K, typename T, typename RefCount>
+inline typename PersistentBST<K, T, RefCount>::Edit PersistentBST<K, T, RefCount>::NewEdit()
+{
+	static std::atomic<Edit> last{ 0 };
+	return ++last;
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Own(const NodePtr& node, Edit edit)
+{
+	if (node->edit == edit) {
+		return node;
+	}
+	return NewNode(node->key, node->data, node->left, node->right, edit);
+}
+
+// node and its right child are owned afterwards, the right child becomes the subtree root
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::RotateLeft(NodePtr node, Edit edit)
+{
+	NodePtr right = Own(node->right, edit);
+	Node* parent = Mutable(node);
+	Node* child = Mutable(right);
+	parent->right = child->left;
+	Update(parent);
+	child->left = std::move(node);
+	Update(child);
+	return right;
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::RotateRight(NodePtr node, Edit edit)
+{
+	NodePtr left = Own(node->left, edit);
+	Node* parent = Mutable(node);
+	Node* child = Mutable(left);
+	parent->left = child->right;
+	Update(parent);
+	child->right = std::move(node);
+	Update(child);
+	return left;
+}
+
+// Restores the height and the AVL balance of an owned node whose children were replaced.
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Rebalance(NodePtr node, Edit edit)
+{
+	Node* parent = Mutable(node);
+	if (Height(parent->left) > Height(parent->right) + 1)
+	{
+		if (Height(parent->left->left) < Height(parent->left->right)) {
+			parent->left = RotateLeft(Own(parent->left, edit), edit);
+		}
+		return RotateRight(std::move(node), edit);
+	}
+	if (Height(parent->right) > Height(parent->left) + 1)
+	{
+		if (Height(parent->right->right) < Height(parent->right->left)) {
+			parent->right = RotateRight(Own(parent->right, edit), edit);
+		}
+		return RotateLeft(std::move(node), edit);
+	}
+	Update(parent);
+	return node;
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::InsertInPlace(const NodePtr& root, const K& key, const T& data, Edit edit, bool& changed)
+{
+	if (root == nullptr)
+	{
+		changed = true;
+		return NewNode(key, data, nullptr, nullptr, edit);
+	}
+	if (root->key > key)
+	{
+		NodePtr left = InsertInPlace(root->left, key, data, edit, changed);
+		if (!changed) {
+			return root;
+		}
+		NodePtr node = Own(root, edit);
+		Mutable(node)->left = std::move(left);
+		return Rebalance(std::move(node), edit);
+	}
+	if (root->key < key)
+	{
+		NodePtr right = InsertInPlace(root->right, key, data, edit, changed);
+		if (!changed) {
+			return root;
+		}
+		NodePtr node = Own(root, edit);
+		Mutable(node)->right = std::move(right);
+		return Rebalance(std::move(node), edit);
 	}
 	return root;
 }
 
-template<typename K, typename T>
-inline PersistentNodePtr<K,T> PersistentBST<K, T>::Erase(NodePtr root, const K& key) const
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::EraseInPlace(const NodePtr& root, const K& key, Edit edit, bool& changed)
 {
 	if (root == nullptr) {
 		return nullptr;
 	}
-	if (root->key > key) {
-		return MakeNode(root, Erase(root->left, key), root->right);
+	if (root->key > key)
+	{
+		NodePtr left = EraseInPlace(root->left, key, edit, changed);
+		if (!changed) {
+			return root;
+		}
+		NodePtr node = Own(root, edit);
+		Mutable(node)->left = std::move(left);
+		return Rebalance(std::move(node), edit);
 	}
-	if (root->key < key) {
-		return MakeNode(root, root->left, Erase(root->right, key));
+	if (root->key < key)
+	{
+		NodePtr right = EraseInPlace(root->right, key, edit, changed);
+		if (!changed) {
+			return root;
+		}
+		NodePtr node = Own(root, edit);
+		Mutable(node)->right = std::move(right);
+		return Rebalance(std::move(node), edit);
 	}
 	// root->key == key
+	changed = true;
 	if (root->left == nullptr) {
 		return root->right;
 	}
 	if (root->right == nullptr) {
-			return root->left;
-	} 
-	// root has both children
-	std::function<NodePtr (NodePtr, NodePtr&)> FindMinNode = [&](NodePtr node, NodePtr& minNode) {
-		if (node->left == nullptr) {
-			minNode = node;
-			return node->right;
-		} else {
-			return MakeNode(node, FindMinNode(node->left, minNode), node->right);
+		return root->left;
+	}
+	// root has both children, the minimum of the right subtree takes its place
+	NodePtr minNode;
+	NodePtr rightBranch = EraseMinInPlace(root->right, minNode, edit);
+	NodePtr node = Own(minNode, edit);
+	Mutable(node)->left = root->left;
+	Mutable(node)->right = std::move(rightBranch);
+	return Rebalance(std::move(node), edit);
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::EraseMinInPlace(const NodePtr& root, NodePtr& minNode, Edit edit)
+{
+	if (root->left == nullptr)
+	{
+		minNode = root;
+		return root->right;
+	}
+	NodePtr left = EraseMinInPlace(root->left, minNode, edit);
+	NodePtr node = Own(root, edit);
+	Mutable(node)->left = std::move(left);
+	return Rebalance(std::move(node), edit);
+}
+
+template<typename K, typename T, typename RefCount>
+inline void PersistentBST<K, T, RefCount>::Expand(std::vector<DiffItem>& stack)
+{
+	const Node* node = stack.back().node;
+	stack.pop_back();
+	if (node->right) {
+		stack.push_back(DiffItem{ node->right.get(), false });
+	}
+	stack.push_back(DiffItem{ node, true });
+	if (node->left) {
+		stack.push_back(DiffItem{ node->left.get(), false });
+	}
+}
+
+template<typename K, typename T, typename RefCount>
+template<typename Callback>
+inline void PersistentBST<K, T, RefCount>::Diff(const PersistentBST& from, const PersistentBST& to, Callback callback)
+{
+	std::vector<DiffItem> before, after;
+	if (from.root) {
+		before.push_back(DiffItem{ from.root.get(), false });
+	}
+	if (to.root) {
+		after.push_back(DiffItem{ to.root.get(), false });
+	}
+
+	while (!before.empty() && !after.empty())
+	{
+		DiffItem first = before.back();
+		DiffItem second = after.back();
+		if (!first.single && !second.single)
+		{
+			if (first.node == second.node)
+			{
+				before.pop_back();
+				after.pop_back();
+				continue;
+			}
+			// expanding the taller side first lets shared subtrees surface on both at once
+			if (first.node->height >= second.node->height) {
+				Expand(before);
+			}
+			if (second.node->height >= first.node->height) {
+				Expand(after);
+			}
 		}
-	};
+		else if (!first.single) {
+			Expand(before);
+		}
+		else if (!second.single) {
+			Expand(after);
+		}
+		else if (first.node->key < second.node->key)
+		{
+			callback(Change::Erased, first.node, static_cast<const Node*>(nullptr));
+			before.pop_back();
+		}
+		else if (second.node->key < first.node->key)
+		{
+			callback(Change::Inserted, static_cast<const Node*>(nullptr), second.node);
+			after.pop_back();
+		}
+		else
+		{
+			if (first.node != second.node && !(first.node->data == second.node->data)) {
+				callback(Change::Changed, first.node, second.node);
+			}
+			before.pop_back();
+			after.pop_back();
+		}
+	}
 
-	NodePtr minNode;
-	NodePtr rightBranch = FindMinNode(root->right, minNode);
-	return MakeNode(minNode, root->left, rightBranch);
+	while (!before.empty())
+	{
+		if (!before.back().single) {
+			Expand(before);
+			continue;
+		}
+		callback(Change::Erased, before.back().node, static_cast<const Node*>(nullptr));
+		before.pop_back();
+	}
+	while (!after.empty())
+	{
+		if (!after.back().single) {
+			Expand(after);
+			continue;
+		}
+		callback(Change::Inserted, static_cast<const Node*>(nullptr), after.back().node);
+		after.pop_back();
+	}
+}
+
+// Joins trees whose keys are ordered left < middle < right, copying middle as the root.
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Join(NodePtr left, const NodePtr& middle, NodePtr right)
+{
+	if (Height(left) > Height(right) + 1) {
+		return JoinRight(std::move(left), middle, right);
+	}
+	if (Height(right) > Height(left) + 1) {
+		return JoinLeft(left, middle, std::move(right));
+	}
+	return MakeNode(middle, std::move(left), std::move(right));
+}
+
+// left is the taller tree: descend its right spine to a subtree right can stand next to.
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::JoinRight(NodePtr left, const NodePtr& middle, const NodePtr& right)
+{
+	if (Height(left->right) <= Height(right) + 1) {
+		return Balance(left, left->left, MakeNode(middle, left->right, right));
+	}
+	return Balance(left, left->left, JoinRight(left->right, middle, right));
 }
 
-template<typename K, typename T>
-inline PersistentNodePtr<K,T> PersistentBST<K, T>::Find(NodePtr root, const K& key) const
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::JoinLeft(const NodePtr& left, const NodePtr& middle, NodePtr right)
+{
+	if (Height(right->left) <= Height(left) + 1) {
+		return Balance(right, MakeNode(middle, left, right->left), right->right);
+	}
+	return Balance(right, JoinLeft(left, middle, right->left), right->right);
+}
+
+// Joins trees with left < right and no middle key.
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Join(NodePtr left, NodePtr right)
+{
+	if (left == nullptr) {
+		return right;
+	}
+	if (right == nullptr) {
+		return left;
+	}
+	NodePtr last;
+	NodePtr rest = SplitLast(left, last);
+	return Join(std::move(rest), last, std::move(right));
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::SplitLast(const NodePtr& root, NodePtr& last)
+{
+	if (root->right == nullptr)
+	{
+		last = root;
+		return root->left;
+	}
+	return Join(root->left, root, SplitLast(root->right, last));
+}
+
+template<typename K, typename T, typename RefCount>
+inline typename PersistentBST<K, T, RefCount>::Parts PersistentBST<K, T, RefCount>::Split(const NodePtr& root, const K& key)
 {
 	if (root == nullptr) {
+		return Parts();
+	}
+	if (key < root->key)
+	{
+		Parts parts = Split(root->left, key);
+		parts.right = Join(std::move(parts.right), root, root->right);
+		return parts;
+	}
+	if (root->key < key)
+	{
+		Parts parts = Split(root->right, key);
+		parts.left = Join(root->left, root, std::move(parts.left));
+		return parts;
+	}
+	return Parts{ root->left, root, root->right };
+}
+
+// Levels of the recursion that may still fork, enough to occupy every core.
+template<typename K, typename T, typename RefCount>
+inline unsigned int PersistentBST<K, T, RefCount>::Forks()
+{
+	if (!RefCount::ThreadSafe) {
+		return 0;
+	}
+	unsigned int forks = 0;
+	for (unsigned int threads = std::thread::hardware_concurrency(); threads > 1; threads = (threads + 1) / 2) {
+		forks++;
+	}
+	return forks;
+}
+
+// Runs both halves, the first one as a separate task if parallel.
+template<typename K, typename T, typename RefCount>
+template<typename First, typename Second>
+inline void PersistentBST<K, T, RefCount>::Fork(bool parallel, First first, Second second)
+{
+	if (!parallel)
+	{
+		first();
+		second();
+		return;
+	}
+	std::future<void> task = std::async(std::launch::async, first);
+	second();
+	task.get();
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Union(const NodePtr& first, const NodePtr& second, unsigned int forks)
+{
+	if (first == nullptr) {
+		return second;
+	}
+	if (second == nullptr) {
+		return first;
+	}
+	Parts parts = Split(second, first->key);
+	bool parallel = forks > 0 && Height(first) >= ForkHeight;
+	unsigned int next = parallel ? forks - 1 : forks;
+
+	NodePtr left, right;
+	Fork(parallel,
+		[&] { left = Union(first->left, parts.left, next); },
+		[&] { right = Union(first->right, parts.right, next); });
+
+	if (parts.middle) {
+		return Join(std::move(left), parts.middle, std::move(right));
+	}
+	if (left == first->left && right == first->right) {
+		return first;
+	}
+	return Join(std::move(left), first, std::move(right));
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Intersection(const NodePtr& first, const NodePtr& second, unsigned int forks)
+{
+	if (first == nullptr || second == nullptr) {
 		return nullptr;
 	}
-	if (root->key < key) {
-		return Find(root->right, key);
+	Parts parts = Split(second, first->key);
+	bool parallel = forks > 0 && Height(first) >= ForkHeight;
+	unsigned int next = parallel ? forks - 1 : forks;
+
+	NodePtr left, right;
+	Fork(parallel,
+		[&] { left = Intersection(first->left, parts.left, next); },
+		[&] { right = Intersection(first->right, parts.right, next); });
+
+	if (parts.middle == nullptr) {
+		return Join(std::move(left), std::move(right));
 	}
-	if (root->key > key) {
-		return Find(root->left, key);
+	if (left == first->left && right == first->right) {
+		return first;
 	}
-	return root;
+	return Join(std::move(left), first, std::move(right));
+}
+
+template<typename K, typename T, typename RefCount>
+inline PersistentNodePtr<K,T,RefCount> PersistentBST<K, T, RefCount>::Difference(const NodePtr& first, const NodePtr& second, unsigned int forks)
+{
+	if (first == nullptr) {
+		return nullptr;
+	}
+	if (second == nullptr) {
+		return first;
+	}
+	Parts parts = Split(second, first->key);
+	bool parallel = forks > 0 && Height(first) >= ForkHeight;
+	unsigned int next = parallel ? forks - 1 : forks;
+
+	NodePtr left, right;
+	Fork(parallel,
+		[&] { left = Difference(first->left, parts.left, next); },
+		[&] { right = Difference(first->right, parts.right, next); });
+
+	if (parts.middle) {
+		return Join(std::move(left), std::move(right));
+	}
+	if (left == first->left && right == first->right) {
+		return first;
+	}
+	return Join(std::move(left), first, std::move(right));
 }
+
+// Usage example
+//PersistentBST<int, std::string, LocalRefCount> v1;	// single-threaded, plain counts
+//auto v2 = v1.Insert(1, "one");
+//auto v3 = v2.Erase(1);
+//if (auto node = v2.Find(1)) {
+//	std::cout << node->Data();
+//}
+//auto batch = v3.Transient();
+//for (int key = 0; key < 10000; key++) {
+//	batch.Insert(key, std::to_string(key));
+//}
+//auto v4 = batch.Persistent();
+//typedef PersistentBST<int, std::string, LocalRefCount> Tree;
+//Tree::Diff(v3, v4, [](Tree::Change change, const Tree::Node* before, const Tree::Node* after) {
+//	Replicate(change, after ? after->Key() : before->Key());
+//});
+//auto effective = Tree::Union(defaults, overrides);
+//auto median = v4.Select((v4.Size() + 1) / 2);
+//size_t window = v4.CountRange(100, 199);		// == v4.Rank(199) - v4.Rank(99)
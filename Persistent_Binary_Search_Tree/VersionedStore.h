@@ -0,0 +1,293 @@
+//**************************************************************************************
+//								< Versioned Store >
+//**************************************************************************************
+// Type:		Multi-version snapshot store
+// Purpose:		One writer publishes PersistentBST versions, many readers take snapshots
+// Name:		Versioned store
+// Implementation details:
+//		> Versions are numbered by sequence and kept in a ring of HistoryLength slots,
+//		  the newest one is also published through an atomic pointer.
+//		> Reclamation is epoch based: a reader announces the global epoch in its slot
+//		  before loading a version and clears it when the snapshot ends. Snapshot
+//		  acquisition is a bounded number of atomic loads and stores (wait-free) and
+//		  touches no reference count.
+//		> A version pushed out of the ring is retired with the current epoch, which is
+//		  then advanced. Retired versions are freed in bulk by the writer (Publish
+//		  every HistoryLength retirements, or Collect) once no reader announces an
+//		  epoch at or before theirs.
+//		> Publish, Current and Collect belong to the writer thread; readers register
+//		  once per thread and use their Reader for every snapshot.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "PersistentBST.h"
+
+template<typename K, typename T>
+class VersionedStore
+{
+public:
+	typedef PersistentBST<K, T, AtomicRefCount> Tree;
+	typedef unsigned long long Sequence;
+	class Reader;
+	class Snapshot;
+
+private:
+	struct Version
+	{
+		Sequence sequence;
+		Tree tree;
+	};
+	struct ReaderSlot
+	{
+		std::atomic<unsigned long long> epoch{ 0 };		// 0 while no snapshot is held
+		unsigned int depth = 0;							// nested snapshots of the owning thread
+		bool registered = false;
+	};
+
+	std::atomic<const Version*> current{ nullptr };
+	std::unique_ptr<std::atomic<const Version*>[]> history;
+	size_t historyLength;
+	Sequence sequence = 0;
+
+	std::atomic<unsigned long long> epoch{ 1 };
+	std::vector<std::pair<unsigned long long, const Version*>> retired;
+
+	std::mutex readersLock;
+	std::list<ReaderSlot> readers;		// stable addresses, slots are reused
+
+public:
+	explicit VersionedStore(size_t _historyLength = 1, Tree initial = Tree())
+		: history(new std::atomic<const Version*>[_historyLength]), historyLength{ _historyLength }
+	{
+		if (historyLength == 0) {
+			throw std::runtime_error("VersionedStore construction error: history length must be positive.");
+		}
+		for (size_t i = 0; i < historyLength; i++) {
+			history[i].store(nullptr, std::memory_order_relaxed);
+		}
+		Publish(std::move(initial));
+	}
+	// Readers and snapshots must be gone by now.
+	~VersionedStore()
+	{
+		for (size_t i = 0; i < historyLength; i++) {
+			delete history[i].load(std::memory_order_relaxed);
+		}
+		for (auto& entry : retired) {
+			delete entry.second;
+		}
+	}
+
+public:
+	VersionedStore(const VersionedStore& store) = delete;
+	VersionedStore& operator=(const VersionedStore& store) = delete;
+
+public:
+	// Makes tree the newest version and returns its sequence number.
+	Sequence Publish(Tree tree);
+	// Writer-side view of the newest version.
+	const Tree& Current() const
+		{ return current.load(std::memory_order_relaxed)->tree; }
+	Sequence LastSequence() const
+		{ return sequence; }
+	// Frees the retired versions no reader can still see, returns how many were freed.
+	size_t Collect();
+
+	Reader Register();
+
+private:
+	unsigned long long oldestActiveEpoch();
+};
+
+// Per-thread reader registration, the source of snapshots.
+template<typename K, typename T>
+class VersionedStore<K, T>::Reader
+{
+	friend class VersionedStore<K, T>;
+private:
+	VersionedStore* store;
+	ReaderSlot* slot;
+
+	Reader(VersionedStore* _store, ReaderSlot* _slot)
+		: store{ _store }, slot{ _slot }
+	{
+	}
+
+public:
+	Reader(Reader&& reader)
+		: store{ reader.store }, slot{ reader.slot }
+	{
+		reader.slot = nullptr;
+	}
+	~Reader()
+	{
+		if (slot != nullptr)
+		{
+			std::lock_guard<std::mutex> guard(store->readersLock);
+			slot->registered = false;
+		}
+	}
+
+public:
+	Reader(const Reader& reader) = delete;
+	Reader& operator=(const Reader& reader) = delete;
+
+public:
+	// The newest version.
+	Snapshot Acquire()
+	{
+		pin();
+		return Snapshot(slot, store->current.load(std::memory_order_seq_cst));
+	}
+	// The version published under sequence, an empty snapshot if it left the history.
+	Snapshot Acquire(Sequence sequence)
+	{
+		pin();
+		const Version* version = store->history[sequence % store->historyLength].load(std::memory_order_seq_cst);
+		if (version && version->sequence != sequence) {
+			version = nullptr;
+		}
+		return Snapshot(slot, version);
+	}
+
+private:
+	void pin()
+	{
+		if (slot->depth++ == 0) {
+			slot->epoch.store(store->epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+		}
+	}
+};
+
+// Pins a version for the reading thread until it goes out of scope.
+template<typename K, typename T>
+class VersionedStore<K, T>::Snapshot
+{
+	friend class VersionedStore<K, T>::Reader;
+private:
+	ReaderSlot* slot;
+	const Version* version;
+
+	Snapshot(ReaderSlot* _slot, const Version* _version)
+		: slot{ _slot }, version{ _version }
+	{
+	}
+
+public:
+	Snapshot(Snapshot&& snapshot)
+		: slot{ snapshot.slot }, version{ snapshot.version }
+	{
+		snapshot.slot = nullptr;
+	}
+	~Snapshot()
+	{
+		if (slot != nullptr && --slot->depth == 0) {
+			slot->epoch.store(0, std::memory_order_release);
+		}
+	}
+
+public:
+	Snapshot(const Snapshot& snapshot) = delete;
+	Snapshot& operator=(const Snapshot& snapshot) = delete;
+
+public:
+	bool Valid() const
+		{ return version != nullptr; }
+	Sequence Number() const
+		{ return version->sequence; }
+	// Valid as long as the snapshot is held.
+	const Tree& View() const
+		{ return version->tree; }
+	// The returned node keeps itself alive beyond the snapshot.
+	typename Tree::NodePtr Find(const K& key) const
+		{ return version->tree.Find(key); }
+};
+
+template<typename K, typename T>
+inline typename VersionedStore<K, T>::Reader VersionedStore<K, T>::Register()
+{
+	std::lock_guard<std::mutex> guard(readersLock);
+	for (auto& slot : readers)
+	{
+		if (!slot.registered)
+		{
+			slot.registered = true;
+			return Reader(this, &slot);
+		}
+	}
+	readers.emplace_back();
+	readers.back().registered = true;
+	return Reader(this, &readers.back());
+}
+
+template<typename K, typename T>
+inline typename VersionedStore<K, T>::Sequence VersionedStore<K, T>::Publish(Tree tree)
+{
+	const Version* version = new Version{ ++sequence, std::move(tree) };
+	const Version* evicted = history[version->sequence % historyLength].exchange(version, std::memory_order_seq_cst);
+	current.store(version, std::memory_order_seq_cst);
+
+	if (evicted != nullptr)
+	{
+		// readers that announce a later epoch can only load the new pointers
+		retired.emplace_back(epoch.load(std::memory_order_seq_cst), evicted);
+		epoch.fetch_add(1, std::memory_order_seq_cst);
+		if (retired.size() >= historyLength) {
+			Collect();
+		}
+	}
+	return version->sequence;
+}
+
+template<typename K, typename T>
+inline unsigned long long VersionedStore<K, T>::oldestActiveEpoch()
+{
+	unsigned long long oldest = epoch.load(std::memory_order_seq_cst);
+	std::lock_guard<std::mutex> guard(readersLock);
+	for (auto& slot : readers)
+	{
+		unsigned long long announced = slot.epoch.load(std::memory_order_seq_cst);
+		if (announced != 0 && announced < oldest) {
+			oldest = announced;
+		}
+	}
+	return oldest;
+}
+
+template<typename K, typename T>
+inline size_t VersionedStore<K, T>::Collect()
+{
+	unsigned long long oldest = oldestActiveEpoch();
+	auto kept = std::partition(retired.begin(), retired.end(),
+		[oldest](const std::pair<unsigned long long, const Version*>& entry) { return entry.first >= oldest; });
+	size_t freed = retired.end() - kept;
+	for (auto entry = kept; entry != retired.end(); ++entry) {
+		delete entry->second;
+	}
+	retired.erase(kept, retired.end());
+	return freed;
+}
+
+// Usage example
+//VersionedStore<int, std::string> store(16);
+//std::thread reader([&] {
+//	auto handle = store.Register();
+//	auto snapshot = handle.Acquire();
+//	if (auto node = snapshot.Find(42)) {
+//		std::cout << snapshot.Number() << ": " << node->Data();
+//	}
+//});
+//auto batch = store.Current().Transient();
+//batch.Insert(42, "answer");
+//store.Publish(batch.Persistent());
+//reader.join();
@@ -0,0 +1,645 @@
+//**************************************************************************************
+//								< Persistent Hash Map >
+//**************************************************************************************
+// Type:		Persistent hash array mapped trie (HAMT)
+// Purpose:		Immutable unordered map versions sharing their unchanged nodes
+// Name:		Persistent hash map
+// Implementation details:
+//		> Every level consumes 5 bits of the 64 bit (mixed) hash: a node has up to 32
+//		  slots, present ones are marked in a bitmap and stored densely, the slot of a
+//		  fragment is the popcount of the bitmap bits below it. A million keys take
+//		  about 4 levels, the deepest possible is 13.
+//		> Entries are stored inline in their node (dataMap), subnodes after them
+//		  (nodeMap), in one allocation sized exactly for the node. A lookup is one
+//		  cache-missing hop per level and a single key comparison at the end.
+//		> Keys whose 64 bit hashes are equal end up in a collision node below the
+//		  last level, searched linearly.
+//		> An update copies the O(log32 n) nodes on its path, everything else is shared.
+//		  Erase inlines a subnode left with a single entry into its parent, so there
+//		  are no chains of nearly empty nodes.
+//		> Reference counting and transients work as in PersistentBST: a transient
+//		  updates the nodes tagged with its edit token in place.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "../Persistent_Binary_Search_Tree/PersistentBST.h"		// reference count policies
+
+template<typename K, typename T, typename RefCount, typename Hash>
+class TransientHashMap;
+
+template<typename K, typename T, typename RefCount = AtomicRefCount, typename Hash = std::hash<K>>
+class PersistentHashMap
+{
+	friend class TransientHashMap<K, T, RefCount, Hash>;
+public:
+	// Edit token of a transient, 0 for nodes that are immutable from birth.
+	typedef unsigned long long Edit;
+
+private:
+	struct Entry
+	{
+		K key;
+		T data;
+	};
+	class Node;
+
+	// Owning pointer to a node, counted inside the node itself.
+	class NodePtr
+	{
+		friend class PersistentHashMap<K, T, RefCount, Hash>;
+	private:
+		const Node* node = nullptr;
+
+		explicit NodePtr(const Node* _node)
+			: node{ _node }
+		{
+			node->references.Increment();
+		}
+
+	public:
+		NodePtr() = default;
+		NodePtr(std::nullptr_t)
+		{
+		}
+		NodePtr(const NodePtr& pointer)
+			: node{ pointer.node }
+		{
+			if (node) {
+				node->references.Increment();
+			}
+		}
+		NodePtr(NodePtr&& pointer)
+			: node{ pointer.node }
+		{
+			pointer.node = nullptr;
+		}
+		NodePtr& operator=(NodePtr pointer)
+		{
+			std::swap(node, pointer.node);
+			return *this;
+		}
+		~NodePtr()
+		{
+			if (node && node->references.Decrement()) {
+				Destroy(const_cast<Node*>(node), node->entries, node->children);
+			}
+		}
+
+	public:
+		const Node* get()			const { return node; }
+		const Node* operator->()	const { return node; }
+		explicit operator bool()	const { return node != nullptr; }
+
+		friend bool operator==(const NodePtr& first, const NodePtr& second) {
+			return first.node == second.node;
+		}
+		friend bool operator!=(const NodePtr& first, const NodePtr& second) {
+			return first.node != second.node;
+		}
+	};
+
+	// Header of a node, followed by its entries and then its children.
+	class Node
+	{
+		friend class PersistentHashMap<K, T, RefCount, Hash>;
+	private:
+		mutable RefCount references;
+		Edit edit;
+		std::uint32_t dataMap;		// fragments holding an entry
+		std::uint32_t nodeMap;		// fragments holding a subnode
+		unsigned int entries;		// popcount of dataMap, except in collision nodes
+		unsigned int children;
+
+	public:
+		Node(std::uint32_t _dataMap, std::uint32_t _nodeMap, unsigned int _entries, unsigned int _children, Edit _edit)
+			: edit{ _edit }, dataMap{ _dataMap }, nodeMap{ _nodeMap }, entries{ _entries }, children{ _children }
+		{
+		}
+		Node(const Node& node) = delete;
+		Node& operator=(const Node& node) = delete;
+
+	public:
+		Entry* Entries() const {
+			return reinterpret_cast<Entry*>(reinterpret_cast<char*>(const_cast<Node*>(this)) + EntriesOffset());
+		}
+		NodePtr* Children() const {
+			return reinterpret_cast<NodePtr*>(reinterpret_cast<char*>(const_cast<Node*>(this)) + ChildrenOffset(entries));
+		}
+	};
+
+	// Node under construction, entries and children are appended in order.
+	class Builder
+	{
+	private:
+		Node* node;
+		unsigned int entries = 0;
+		unsigned int children = 0;
+
+	public:
+		Builder(std::uint32_t dataMap, std::uint32_t nodeMap, unsigned int entryCount, unsigned int childCount, Edit edit)
+		{
+			void* memory = ::operator new(ChildrenOffset(entryCount) + childCount * sizeof(NodePtr));
+			node = new (memory) Node(dataMap, nodeMap, entryCount, childCount, edit);
+		}
+		~Builder()
+		{
+			if (node) {
+				Destroy(node, entries, children);
+			}
+		}
+		Builder(const Builder& builder) = delete;
+		Builder& operator=(const Builder& builder) = delete;
+
+	public:
+		void Add(const K& key, const T& data)
+		{
+			new (node->Entries() + entries) Entry{ key, data };
+			entries++;
+		}
+		void Add(const Entry& entry)
+		{
+			Add(entry.key, entry.data);
+		}
+		void Add(NodePtr child)
+		{
+			new (node->Children() + children) NodePtr(std::move(child));
+			children++;
+		}
+		NodePtr Finish()
+		{
+			Node* built = node;
+			node = nullptr;
+			return NodePtr(built);
+		}
+	};
+
+	static const unsigned int Bits		= 5;
+	static const unsigned int HashBits	= 64;
+
+	NodePtr root = nullptr;
+	size_t size = 0;
+
+	PersistentHashMap(NodePtr _root, size_t _size)
+		: root{ std::move(_root) }, size{ _size }
+	{
+	}
+
+public:
+	PersistentHashMap() = default;
+
+public:
+	// An existing key keeps its data, as in PersistentBST.
+	PersistentHashMap Insert(const K& key, const T& data) const
+	{
+		bool added = false;
+		NodePtr updated = Insert(root, key, data, HashOf(key), 0, 0, added);
+		return PersistentHashMap(std::move(updated), added ? size + 1 : size);
+	}
+	PersistentHashMap Erase(const K& key) const
+	{
+		bool erased = false;
+		NodePtr updated = Erase(root, key, HashOf(key), 0, 0, erased);
+		return PersistentHashMap(std::move(updated), erased ? size - 1 : size);
+	}
+	// The data stays valid as long as a version containing it is alive.
+	const T* Find(const K& key) const {
+		return Find(root, key);
+	}
+	TransientHashMap<K, T, RefCount, Hash> Transient() const {
+		return TransientHashMap<K, T, RefCount, Hash>(root, size);
+	}
+
+	bool Empty() const {
+		return root == nullptr;
+	}
+	size_t Size() const {
+		return size;
+	}
+
+private:
+	static size_t EntriesOffset() {
+		return (sizeof(Node) + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+	}
+	static size_t ChildrenOffset(unsigned int entries) {
+		return (EntriesOffset() + entries * sizeof(Entry) + alignof(NodePtr) - 1) / alignof(NodePtr) * alignof(NodePtr);
+	}
+	static void Destroy(Node* node, unsigned int entries, unsigned int children);
+
+	static std::uint64_t HashOf(const K& key);
+	static unsigned int PopCount(std::uint32_t bits)
+	{
+#ifdef _MSC_VER
+		return __popcnt(bits);
+#else
+		return __builtin_popcount(bits);
+#endif
+	}
+	static std::uint32_t Bit(std::uint64_t hash, unsigned int shift) {
+		return std::uint32_t(1) << ((hash >> shift) & 31);
+	}
+	// dense index of the slot marked by bit
+	static unsigned int Index(std::uint32_t map, std::uint32_t bit) {
+		return PopCount(map & (bit - 1));
+	}
+
+	static const T* Find(const NodePtr& root, const K& key);
+	static NodePtr Insert(const NodePtr& node, const K& key, const T& data, std::uint64_t hash, unsigned int shift, Edit edit, bool& added);
+	static NodePtr Erase(const NodePtr& node, const K& key, std::uint64_t hash, unsigned int shift, Edit edit, bool& erased);
+	static NodePtr Pair(const Entry& entry, std::uint64_t entryHash, const K& key, const T& data, std::uint64_t hash, unsigned int shift, Edit edit);
+
+	// copies of node with one slot changed, bit is 0 in collision nodes
+	static NodePtr InsertEntry(const NodePtr& node, std::uint32_t bit, unsigned int index, const K& key, const T& data, Edit edit);
+	static NodePtr RemoveEntry(const NodePtr& node, std::uint32_t bit, unsigned int index, Edit edit);
+	static NodePtr SetChild(const NodePtr& node, unsigned int index, NodePtr child, Edit edit);
+	static NodePtr EntryToChild(const NodePtr& node, std::uint32_t bit, unsigned int index, NodePtr child, Edit edit);
+	static NodePtr ChildToEntry(const NodePtr& node, std::uint32_t bit, unsigned int index, const Entry& entry, Edit edit);
+
+	static Edit NewEdit();
+	static bool Owned(const NodePtr& node, Edit edit) {
+		return edit != 0 && node->edit == edit;
+	}
+};
+
+// Mutable view of a version for batched updates. Nodes it creates are tagged with its
+// edit token and updated in place afterwards, shared nodes are copied once on first touch.
+template<typename K, typename T, typename RefCount, typename Hash>
+class TransientHashMap
+{
+	friend class PersistentHashMap<K, T, RefCount, Hash>;
+	typedef PersistentHashMap<K, T, RefCount, Hash> Map;
+	typedef typename Map::NodePtr NodePtr;
+	typedef typename Map::Edit Edit;
+
+private:
+	NodePtr root;
+	size_t size;
+	Edit edit;
+
+	TransientHashMap(NodePtr _root, size_t _size)
+		: root{ std::move(_root) }, size{ _size }, edit{ Map::NewEdit() }
+	{
+	}
+
+public:
+	TransientHashMap(TransientHashMap&& transient) = default;
+	TransientHashMap& operator=(TransientHashMap&& transient) = default;
+
+public:
+	TransientHashMap(const TransientHashMap& transient) = delete;
+	TransientHashMap& operator=(const TransientHashMap& transient) = delete;
+
+public:
+	void Insert(const K& key, const T& data)
+	{
+		bool added = false;
+		root = Map::Insert(root, key, data, Map::HashOf(key), 0, edit, added);
+		size += added ? 1 : 0;
+	}
+	void Erase(const K& key)
+	{
+		bool erased = false;
+		root = Map::Erase(root, key, Map::HashOf(key), 0, edit, erased);
+		size -= erased ? 1 : 0;
+	}
+	// The data may move with later updates of this transient.
+	const T* Find(const K& key) const {
+		return Map::Find(root, key);
+	}
+	bool Empty() const {
+		return root == nullptr;
+	}
+	size_t Size() const {
+		return size;
+	}
+
+	// Freezes the current state into a version. The transient stays usable with a new
+	// token, so it never modifies the nodes of the returned version.
+	Map Persistent()
+	{
+		edit = Map::NewEdit();
+		return Map(root, size);
+	}
+};
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline void PersistentHashMap<K, T, RefCount, Hash>::Destroy(Node* node, unsigned int entries, unsigned int children)
+{
+	for (unsigned int i = 0; i < entries; i++) {
+		node->Entries()[i].~Entry();
+	}
+	for (unsigned int i = 0; i < children; i++) {
+		node->Children()[i].~NodePtr();
+	}
+	node->~Node();
+	::operator delete(node);
+}
+
+// std::hash is the identity for integers on common libraries: the MurmurHash3 finalizer
+// spreads every bit of it into the low fragments the trie consumes first.
+template<typename K, typename T, typename RefCount, typename Hash>
+inline std::uint64_t PersistentHashMap<K, T, RefCount, Hash>::HashOf(const K& key)
+{
+	std::uint64_t hash = Hash()(key);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::Edit PersistentHashMap<K, T, RefCount, Hash>::NewEdit()
+{
+	static std::atomic<Edit> last{ 0 };
+	return ++last;
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline const T* PersistentHashMap<K, T, RefCount, Hash>::Find(const NodePtr& root, const K& key)
+{
+	std::uint64_t hash = HashOf(key);
+	const Node* node = root.get();
+	for (unsigned int shift = 0; node != nullptr; shift += Bits)
+	{
+		if (shift >= HashBits)
+		{
+			for (unsigned int i = 0; i < node->entries; i++)
+			{
+				if (node->Entries()[i].key == key) {
+					return &node->Entries()[i].data;
+				}
+			}
+			return nullptr;
+		}
+		std::uint32_t bit = Bit(hash, shift);
+		if (node->dataMap & bit)
+		{
+			const Entry& entry = node->Entries()[Index(node->dataMap, bit)];
+			return (entry.key == key) ? &entry.data : nullptr;
+		}
+		if ((node->nodeMap & bit) == 0) {
+			return nullptr;
+		}
+		node = node->Children()[Index(node->nodeMap, bit)].get();
+	}
+	return nullptr;
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::Insert(
+	const NodePtr& node, const K& key, const T& data, std::uint64_t hash, unsigned int shift, Edit edit, bool& added)
+{
+	if (node == nullptr)
+	{
+		added = true;
+		Builder builder(Bit(hash, shift), 0, 1, 0, edit);
+		builder.Add(key, data);
+		return builder.Finish();
+	}
+	if (shift >= HashBits)
+	{
+		for (unsigned int i = 0; i < node->entries; i++)
+		{
+			if (node->Entries()[i].key == key) {
+				return node;
+			}
+		}
+		added = true;
+		return InsertEntry(node, 0, node->entries, key, data, edit);
+	}
+
+	std::uint32_t bit = Bit(hash, shift);
+	if (node->dataMap & bit)
+	{
+		unsigned int index = Index(node->dataMap, bit);
+		const Entry& entry = node->Entries()[index];
+		if (entry.key == key) {
+			return node;
+		}
+		// both keys share the fragment, they move one level down
+		added = true;
+		NodePtr child = Pair(entry, HashOf(entry.key), key, data, hash, shift + Bits, edit);
+		return EntryToChild(node, bit, index, std::move(child), edit);
+	}
+	if (node->nodeMap & bit)
+	{
+		unsigned int index = Index(node->nodeMap, bit);
+		const NodePtr& child = node->Children()[index];
+		NodePtr updated = Insert(child, key, data, hash, shift + Bits, edit, added);
+		if (updated == child) {
+			return node;
+		}
+		return SetChild(node, index, std::move(updated), edit);
+	}
+	added = true;
+	return InsertEntry(node, bit, Index(node->dataMap, bit), key, data, edit);
+}
+
+// Subtree holding two entries whose hashes agree below shift.
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::Pair(
+	const Entry& entry, std::uint64_t entryHash, const K& key, const T& data, std::uint64_t hash, unsigned int shift, Edit edit)
+{
+	if (shift >= HashBits)
+	{
+		Builder builder(0, 0, 2, 0, edit);
+		builder.Add(entry);
+		builder.Add(key, data);
+		return builder.Finish();
+	}
+	std::uint32_t first = Bit(entryHash, shift);
+	std::uint32_t second = Bit(hash, shift);
+	if (first == second)
+	{
+		Builder builder(0, first, 0, 1, edit);
+		builder.Add(Pair(entry, entryHash, key, data, hash, shift + Bits, edit));
+		return builder.Finish();
+	}
+	Builder builder(first | second, 0, 2, 0, edit);
+	if (first < second)
+	{
+		builder.Add(entry);
+		builder.Add(key, data);
+	}
+	else
+	{
+		builder.Add(key, data);
+		builder.Add(entry);
+	}
+	return builder.Finish();
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::Erase(
+	const NodePtr& node, const K& key, std::uint64_t hash, unsigned int shift, Edit edit, bool& erased)
+{
+	if (node == nullptr) {
+		return nullptr;
+	}
+	if (shift >= HashBits)
+	{
+		for (unsigned int i = 0; i < node->entries; i++)
+		{
+			if (node->Entries()[i].key == key)
+			{
+				erased = true;
+				return (node->entries == 1) ? nullptr : RemoveEntry(node, 0, i, edit);
+			}
+		}
+		return node;
+	}
+
+	std::uint32_t bit = Bit(hash, shift);
+	if (node->dataMap & bit)
+	{
+		unsigned int index = Index(node->dataMap, bit);
+		if (!(node->Entries()[index].key == key)) {
+			return node;
+		}
+		erased = true;
+		if (node->entries == 1 && node->children == 0) {
+			return nullptr;
+		}
+		return RemoveEntry(node, bit, index, edit);
+	}
+	if (node->nodeMap & bit)
+	{
+		unsigned int index = Index(node->nodeMap, bit);
+		const NodePtr& child = node->Children()[index];
+		NodePtr updated = Erase(child, key, hash, shift + Bits, edit, erased);
+		if (updated == child) {
+			return node;
+		}
+		// a subnode is never left with a single entry, the parents inline it level by level
+		if (updated->entries == 1 && updated->children == 0) {
+			return ChildToEntry(node, bit, index, updated->Entries()[0], edit);
+		}
+		return SetChild(node, index, std::move(updated), edit);
+	}
+	return node;
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::InsertEntry(
+	const NodePtr& node, std::uint32_t bit, unsigned int index, const K& key, const T& data, Edit edit)
+{
+	Builder builder(node->dataMap | bit, node->nodeMap, node->entries + 1, node->children, edit);
+	for (unsigned int i = 0; i < index; i++) {
+		builder.Add(node->Entries()[i]);
+	}
+	builder.Add(key, data);
+	for (unsigned int i = index; i < node->entries; i++) {
+		builder.Add(node->Entries()[i]);
+	}
+	for (unsigned int i = 0; i < node->children; i++) {
+		builder.Add(node->Children()[i]);
+	}
+	return builder.Finish();
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::RemoveEntry(
+	const NodePtr& node, std::uint32_t bit, unsigned int index, Edit edit)
+{
+	Builder builder(node->dataMap & ~bit, node->nodeMap, node->entries - 1, node->children, edit);
+	for (unsigned int i = 0; i < node->entries; i++)
+	{
+		if (i != index) {
+			builder.Add(node->Entries()[i]);
+		}
+	}
+	for (unsigned int i = 0; i < node->children; i++) {
+		builder.Add(node->Children()[i]);
+	}
+	return builder.Finish();
+}
+
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::SetChild(
+	const NodePtr& node, unsigned int index, NodePtr child, Edit edit)
+{
+	if (Owned(node, edit))
+	{
+		node->Children()[index] = std::move(child);
+		return node;
+	}
+	Builder builder(node->dataMap, node->nodeMap, node->entries, node->children, edit);
+	for (unsigned int i = 0; i < node->entries; i++) {
+		builder.Add(node->Entries()[i]);
+	}
+	for (unsigned int i = 0; i < node->children; i++) {
+		builder.Add(i == index ? std::move(child) : node->Children()[i]);
+	}
+	return builder.Finish();
+}
+
+// The entry at index moves into child, a new subnode in the same slot.
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::EntryToChild(
+	const NodePtr& node, std::uint32_t bit, unsigned int index, NodePtr child, Edit edit)
+{
+	unsigned int position = Index(node->nodeMap, bit);
+	Builder builder(node->dataMap & ~bit, node->nodeMap | bit, node->entries - 1, node->children + 1, edit);
+	for (unsigned int i = 0; i < node->entries; i++)
+	{
+		if (i != index) {
+			builder.Add(node->Entries()[i]);
+		}
+	}
+	for (unsigned int i = 0; i < position; i++) {
+		builder.Add(node->Children()[i]);
+	}
+	builder.Add(std::move(child));
+	for (unsigned int i = position; i < node->children; i++) {
+		builder.Add(node->Children()[i]);
+	}
+	return builder.Finish();
+}
+
+// The subnode at index is replaced by entry, its only remaining one.
+template<typename K, typename T, typename RefCount, typename Hash>
+inline typename PersistentHashMap<K, T, RefCount, Hash>::NodePtr PersistentHashMap<K, T, RefCount, Hash>::ChildToEntry(
+	const NodePtr& node, std::uint32_t bit, unsigned int index, const Entry& entry, Edit edit)
+{
+	unsigned int position = Index(node->dataMap, bit);
+	Builder builder(node->dataMap | bit, node->nodeMap & ~bit, node->entries + 1, node->children - 1, edit);
+	for (unsigned int i = 0; i < position; i++) {
+		builder.Add(node->Entries()[i]);
+	}
+	builder.Add(entry);
+	for (unsigned int i = position; i < node->entries; i++) {
+		builder.Add(node->Entries()[i]);
+	}
+	for (unsigned int i = 0; i < node->children; i++)
+	{
+		if (i != index) {
+			builder.Add(node->Children()[i]);
+		}
+	}
+	return builder.Finish();
+}
+
+// Usage example
+//PersistentHashMap<std::string, int> v1;
+//auto v2 = v1.Insert("one", 1);
+//auto v3 = v2.Erase("one");
+//if (const int* data = v2.Find("one")) {
+//	std::cout << *data;
+//}
+//auto batch = v3.Transient();
+//for (int key = 0; key < 10000; key++) {
+//	batch.Insert(std::to_string(key), key);
+//}
+//auto v4 = batch.Persistent();
@@ -0,0 +1,101 @@
+//**************************************************************************************
+//								< Priority Queue >
+//**************************************************************************************
+// Type:		Compile-time interface
+// Purpose:		Common priority-queue surface of BinomialHeap, PairingHeap and FibonacciHeap
+// Name:		Priority queue
+// Implementation details:
+//		> IsPriorityQueue<Heap, T> checks for Push(value) -> Heap::Handle, Top(),
+//		  Pop(), Meld(Heap&&) and DecreaseKey(handle, value) for const T& and T&&.
+//		> Handles are node pointers: nullptr never names a live element.
+//		> ShortestPaths is the decrease-key heavy workload the heaps are meant to be
+//		  swapped under: the heap is a template argument, the algorithm is shared.
+//		  RoadGraph.h generates road-style graphs and times it per heap.
+//
+//		  Heap				Push		Pop				DecreaseKey		Meld
+//		  BinomialHeap		O(1) am.	O(log n)		O(log n)		O(log n)
+//		  PairingHeap		O(1)		O(log n) am.	o(log n) am.	O(1)
+//		  FibonacciHeap		O(1)		O(log n) am.	O(1) am.		O(1)
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <type_traits>
+
+namespace PriorityQueue
+{
+	template<typename...>
+	using Void = void;
+
+	template<typename Heap, typename T, typename = void>
+	struct IsPriorityQueue : std::false_type
+	{
+	};
+
+	template<typename Heap, typename T>
+	struct IsPriorityQueue<Heap, T, Void<
+		typename Heap::Handle,
+		decltype(std::declval<Heap&>().Top()),
+		decltype(std::declval<Heap&>().Pop()),
+		decltype(std::declval<Heap&>().Meld(std::declval<Heap&&>())),
+		decltype(std::declval<Heap&>().DecreaseKey(std::declval<typename Heap::Handle>(), std::declval<const T&>())),
+		decltype(std::declval<Heap&>().DecreaseKey(std::declval<typename Heap::Handle>(), std::declval<T&&>()))>>
+		: std::integral_constant<bool,
+			std::is_same<decltype(std::declval<Heap&>().Push(std::declval<const T&>())), typename Heap::Handle>::value &&
+			std::is_convertible<decltype(std::declval<Heap&>().Top()), const T&>::value>
+	{
+	};
+
+	// Single-source shortest paths over an adjacency list of (target, weight) pairs.
+	// Unreachable vertices keep std::numeric_limits<Weight>::max().
+	template<template<typename> class Heap, typename Weight>
+	std::vector<Weight> ShortestPaths(const std::vector<std::vector<std::pair<std::size_t, Weight>>>& graph, std::size_t source)
+	{
+		typedef std::pair<Weight, std::size_t> Entry;
+		typedef Heap<Entry> Queue;
+		static_assert(IsPriorityQueue<Queue, Entry>::value, "ShortestPaths requires a priority queue.");
+
+		std::vector<Weight> distances(graph.size(), std::numeric_limits<Weight>::max());
+		std::vector<typename Queue::Handle> handles(graph.size(), nullptr);
+		std::vector<bool> settled(graph.size(), false);
+
+		Queue queue;
+		distances[source] = Weight();
+		handles[source] = queue.Push(Entry(Weight(), source));
+		while (!queue.Empty())
+		{
+			std::size_t vertex = queue.Top().second;
+			queue.Pop();
+			handles[vertex] = nullptr;
+			settled[vertex] = true;
+
+			for (const auto& edge : graph[vertex])
+			{
+				std::size_t target = edge.first;
+				Weight distance = distances[vertex] + edge.second;
+				if (settled[target] || !(distance < distances[target])) {
+					continue;
+				}
+				distances[target] = distance;
+				if (handles[target] == nullptr) {
+					handles[target] = queue.Push(Entry(distance, target));
+				} else {
+					queue.DecreaseKey(handles[target], Entry(distance, target));
+				}
+			}
+		}
+		return distances;
+	}
+}
+
+// Usage example
+//static_assert(PriorityQueue::IsPriorityQueue<FibonacciHeap<int>, int>::value, "");
+//std::vector<std::vector<std::pair<std::size_t, unsigned int>>> graph(n);
+//auto binomial = PriorityQueue::ShortestPaths<BinomialHeap>(graph, 0);
+//auto pairing = PriorityQueue::ShortestPaths<PairingHeap>(graph, 0);
+//auto fibonacci = PriorityQueue::ShortestPaths<FibonacciHeap>(graph, 0);
@@ -0,0 +1,129 @@
+//**************************************************************************************
+//								< Road Graph >
+//**************************************************************************************
+// Type:		Benchmark utility
+// Purpose:		Synthetic road-style graphs and a Dijkstra timing harness comparing
+//				BinomialHeap, PairingHeap and FibonacciHeap under ShortestPaths
+// Name:		Road graph
+// Implementation details:
+//		> Grid lays the vertices out on a width x height lattice linked to their four
+//		  neighbours in both directions, as a street grid: each street segment is
+//		  kept with probability keep and weighs a random length in [100, 1000).
+//		  Every arterialSpacing-th row and column is an arterial road four times as
+//		  fast, so shortest paths detour through them and distances get lowered
+//		  several times before they settle, as on real road networks.
+//		> Search runs ShortestPaths from every source with the given heap and
+//		  reports the mean time per search. The checksum adds up the distances of
+//		  the reached vertices, so runs with different heaps can be compared.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <utility>
+#include "PriorityQueue.h"
+
+namespace RoadGraph
+{
+	typedef std::vector<std::vector<std::pair<std::size_t, unsigned int>>> Graph;
+
+	struct Stats
+	{
+		double msPerSearch				= 0;
+		std::size_t reached				= 0;	// vertices reached, summed over the searches
+		unsigned long long checksum		= 0;
+	};
+
+	// Street grid with faster arterials, vertex (x, y) is y * width + x.
+	inline Graph Grid(unsigned int width, unsigned int height, double keep = 0.9,
+		unsigned int arterialSpacing = 16, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<unsigned int> length(100, 999);
+		std::bernoulli_distribution kept(keep);
+
+		Graph graph(static_cast<std::size_t>(width) * height);
+		auto link = [&](std::size_t from, std::size_t to, bool arterial)
+		{
+			unsigned int weight = length(random);
+			if (arterial) {
+				weight /= 4;
+			}
+			else if (!kept(random)) {
+				return;
+			}
+			graph[from].emplace_back(to, weight);
+			graph[to].emplace_back(from, weight);
+		};
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				std::size_t vertex = static_cast<std::size_t>(y) * width + x;
+				if (x + 1 < width) {
+					link(vertex, vertex + 1, arterialSpacing && y % arterialSpacing == 0);
+				}
+				if (y + 1 < height) {
+					link(vertex, vertex + width, arterialSpacing && x % arterialSpacing == 0);
+				}
+			}
+		}
+		return graph;
+	}
+
+	// Uniformly drawn search sources.
+	inline std::vector<std::size_t> Sources(const Graph& graph, std::size_t count, unsigned int seed = 1)
+	{
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<std::size_t> vertex(0, graph.size() - 1);
+		std::vector<std::size_t> sources(count);
+		for (auto& source : sources) {
+			source = vertex(random);
+		}
+		return sources;
+	}
+
+	// Times ShortestPaths with Heap from every source.
+	template<template<typename> class Heap>
+	Stats Search(const Graph& graph, const std::vector<std::size_t>& sources)
+	{
+		Stats stats;
+		if (sources.empty()) {
+			return stats;
+		}
+
+		double elapsed = 0;
+		for (std::size_t source : sources)
+		{
+			auto start = std::chrono::steady_clock::now();
+			std::vector<unsigned int> distances = PriorityQueue::ShortestPaths<Heap>(graph, source);
+			auto finish = std::chrono::steady_clock::now();
+			elapsed += std::chrono::duration<double, std::milli>(finish - start).count();
+
+			for (unsigned int distance : distances)
+			{
+				if (distance != std::numeric_limits<unsigned int>::max())
+				{
+					stats.reached++;
+					stats.checksum += distance;
+				}
+			}
+		}
+		stats.msPerSearch = elapsed / sources.size();
+		return stats;
+	}
+}
+
+// Usage example
+//auto graph = RoadGraph::Grid(1000, 1000);
+//auto sources = RoadGraph::Sources(graph, 8);
+//auto binomial = RoadGraph::Search<BinomialHeap>(graph, sources);
+//auto pairing = RoadGraph::Search<PairingHeap>(graph, sources);
+//auto fibonacci = RoadGraph::Search<FibonacciHeap>(graph, sources);
+//std::cout << binomial.msPerSearch << " / " << pairing.msPerSearch << " / "
+//	<< fibonacci.msPerSearch << " ms per search" << std::endl;
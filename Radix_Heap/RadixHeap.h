@@ -0,0 +1,285 @@
+//**************************************************************************************
+//								< Radix Heap >
+//**************************************************************************************
+// Type:		Bucketed monotone priority queue
+// Purpose:		Priority queue for non-decreasing unsigned integer keys (timestamps)
+// Name:		Radix heap
+// Implementation details:
+//		> Pushed keys must not be less than the last popped one.
+//		> Bucket i holds the keys whose highest bit differing from last is bit i - 1,
+//		  bucket 0 holds the keys equal to last.
+//		> Pop on an empty bucket 0 moves last to the minimum of the next non-empty
+//		  bucket and redistributes that bucket downwards: every entry moves at most
+//		  once per bit.
+//		> A Pop that empties bucket 0 locates that minimum right away and Push keeps
+//		  it up to date, so Top is O(1). The redistribution itself waits for the next
+//		  Pop: moving last earlier would reject keys between the popped one and it.
+//		> Push is O(1), Pop O(log C) amortized for keys of C bits, no key is compared
+//		  with another one outside of the redistributed bucket.
+//		> Keys are unsigned 32 or 64 bit, the bit scan is picked at compile time.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+template<typename Key, size_t Size = sizeof(Key)>
+struct RadixBits;
+
+template<typename Key>
+struct RadixBits<Key, 4>
+{
+	// index of the highest set bit plus one, 0 for 0
+	static unsigned int Width(Key value)
+	{
+		if (value == 0) {
+			return 0;
+		}
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, static_cast<unsigned long>(value));
+		return index + 1;
+#else
+		return 32 - __builtin_clz(static_cast<std::uint32_t>(value));
+#endif
+	}
+};
+
+template<typename Key>
+struct RadixBits<Key, 8>
+{
+	static unsigned int Width(Key value)
+	{
+		if (value == 0) {
+			return 0;
+		}
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, static_cast<unsigned __int64>(value));
+		return index + 1;
+#else
+		return 64 - __builtin_clzll(static_cast<std::uint64_t>(value));
+#endif
+	}
+};
+
+template<typename Key, typename T>
+class RadixHeap
+{
+	static_assert(std::is_unsigned<Key>::value && (sizeof(Key) == 4 || sizeof(Key) == 8),
+		"RadixHeap keys must be 32 or 64 bit unsigned integers.");
+
+public:
+	typedef std::pair<Key, T> Entry;
+
+private:
+	static const unsigned int BucketCount = std::numeric_limits<Key>::digits + 1;
+
+	std::vector<Entry> buckets[BucketCount];
+	Key last = 0;
+	size_t size = 0;
+	// the minimum while bucket 0 is empty and the heap is not
+	unsigned int minBucket = 0;
+	size_t minIndex = 0;
+
+public:
+	RadixHeap() = default;
+	RadixHeap(RadixHeap&& heap)
+	{
+		Swap(heap);
+	}
+	RadixHeap& operator=(RadixHeap&& heap)
+	{
+		Swap(heap);
+		return *this;
+	}
+
+public:
+	RadixHeap(const RadixHeap& heap) = delete;
+	RadixHeap& operator=(const RadixHeap& heap) = delete;
+
+public:
+	void Push(Key key, const T& value)
+		{ insert(key, value); }
+	void Push(Key key, T&& value)
+		{ insert(key, std::move(value)); }
+
+	void Pop();
+	T PopValue();
+	const T& Top() const
+		{ return top().second; }
+	const T& First() const
+		{ return Top(); }
+	Key TopKey() const
+		{ return top().first; }
+	// The lower bound on keys accepted by Push.
+	Key Last() const
+		{ return last; }
+
+	void Meld(RadixHeap&& heap);
+	void Clear();
+
+	bool Empty() const
+		{ return size == 0; }
+	size_t Size() const
+		{ return size; }
+
+	void Swap(RadixHeap& heap)
+	{
+		for (unsigned int i = 0; i < BucketCount; i++) {
+			buckets[i].swap(heap.buckets[i]);
+		}
+		std::swap(last, heap.last);
+		std::swap(size, heap.size);
+		std::swap(minBucket, heap.minBucket);
+		std::swap(minIndex, heap.minIndex);
+	}
+
+private:
+	unsigned int bucketOf(Key key) const
+		{ return RadixBits<Key>::Width(key ^ last); }
+
+	template<typename Value>
+	void insert(Key key, Value&& value);
+	const Entry& top() const;
+	void locate();
+	void refill();
+};
+
+template<typename Key, typename T>
+template<typename Value>
+inline void RadixHeap<Key, T>::insert(Key key, Value&& value)
+{
+	if (key < last) {
+		throw std::runtime_error("RadixHeap push failed: key is less than the last popped one.");
+	}
+	unsigned int index = bucketOf(key);
+	buckets[index].emplace_back(key, std::forward<Value>(value));
+	size++;
+	if (buckets[0].empty() &&
+		(size == 1 || index < minBucket || (index == minBucket && key < buckets[minBucket][minIndex].first)))
+	{
+		minBucket = index;
+		minIndex = buckets[index].size() - 1;
+	}
+}
+
+template<typename Key, typename T>
+inline const typename RadixHeap<Key, T>::Entry& RadixHeap<Key, T>::top() const
+{
+	if (size == 0) {
+		throw std::runtime_error("RadixHeap is empty.");
+	}
+	return buckets[0].empty() ? buckets[minBucket][minIndex] : buckets[0].back();
+}
+
+// Finds the minimum of the first non-empty bucket, once bucket 0 has run empty.
+template<typename Key, typename T>
+inline void RadixHeap<Key, T>::locate()
+{
+	minBucket = 0;
+	while (buckets[minBucket].empty()) {
+		minBucket++;
+	}
+	const std::vector<Entry>& bucket = buckets[minBucket];
+	minIndex = 0;
+	for (size_t i = 1; i < bucket.size(); i++)
+	{
+		if (bucket[i].first < bucket[minIndex].first) {
+			minIndex = i;
+		}
+	}
+}
+
+template<typename Key, typename T>
+inline void RadixHeap<Key, T>::refill()
+{
+	std::vector<Entry>& bucket = buckets[minBucket];
+	// all entries share the bits above the bucket index with the new last, so they land lower
+	last = bucket[minIndex].first;
+	for (Entry& entry : bucket) {
+		buckets[bucketOf(entry.first)].push_back(std::move(entry));
+	}
+	bucket.clear();
+}
+
+template<typename Key, typename T>
+inline void RadixHeap<Key, T>::Pop()
+{
+	if (size == 0) {
+		throw std::runtime_error("RadixHeap is empty.");
+	}
+	if (buckets[0].empty()) {
+		refill();
+	}
+	buckets[0].pop_back();
+	size--;
+	if (buckets[0].empty() && size != 0) {
+		locate();
+	}
+}
+
+template<typename Key, typename T>
+inline T RadixHeap<Key, T>::PopValue()
+{
+	if (size == 0) {
+		throw std::runtime_error("RadixHeap is empty.");
+	}
+	if (buckets[0].empty()) {
+		refill();
+	}
+	T value = std::move(buckets[0].back().second);
+	Pop();
+	return value;
+}
+
+// O(n): entries of the heap with the greater last are rebucketed against the lower one,
+// the melded heap accepts keys down to the lower last.
+template<typename Key, typename T>
+inline void RadixHeap<Key, T>::Meld(RadixHeap&& heap)
+{
+	if (&heap == this) {
+		return;
+	}
+	if (heap.last < last) {
+		Swap(heap);
+	}
+	for (unsigned int i = 0; i < BucketCount; i++)
+	{
+		for (Entry& entry : heap.buckets[i]) {
+			buckets[bucketOf(entry.first)].push_back(std::move(entry));
+		}
+		heap.buckets[i].clear();
+	}
+	size += heap.size;
+	heap.size = 0;
+	if (buckets[0].empty() && size != 0) {
+		locate();
+	}
+}
+
+template<typename Key, typename T>
+inline void RadixHeap<Key, T>::Clear()
+{
+	for (auto& bucket : buckets) {
+		bucket.clear();
+	}
+	last = 0;
+	size = 0;
+}
+
+// Usage example
+//RadixHeap<unsigned long long, std::function<void()>> timers;
+//timers.Push(now + 250, [] { Flush(); });
+//while (!timers.Empty() && timers.TopKey() <= now) {
+//	timers.PopValue()();
+//}
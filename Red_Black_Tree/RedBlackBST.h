@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include "../Binary_Tree_Nodes/TreeNodes.h"
+
 template<typename K, typename T>
 class RedBlackBST
 {
@@ -21,12 +24,13 @@ public:
 
 private:
 	Node* root 	= nullptr;
+	size_t rotations	= 0;
 
 public:
 	RedBlackBST()	
 		{	}
 	~RedBlackBST()	
-		{ delete root; }
+		{ Clear(); }
 
 public:
 	RedBlackBST(const RedBlackBST& tree)			= delete;
@@ -37,10 +41,15 @@ public:
 	void Erase(const K& key);
 
 	Node* Find(const K& key);
+	void Clear();
 
 	Node* Root()
 		{ return root; }
 
+	unsigned int Depth(const Node* node) const;
+	size_t Rotations() const
+		{ return rotations; }
+
 	template<typename Func>
 	void InOrder(Node* _root, Func func);
 
@@ -76,6 +85,7 @@ template<typename K, typename T>
 class RedBlackBST<K,T>::Node
 {
 	friend class RedBlackBST<K,T>;
+	friend struct TreeNodes<Node>;
 private:
 	K key;
 	T* data			= nullptr;
@@ -92,16 +102,6 @@ public:
 	}
 	~Node()
 	{
-		if (parent) 
-		{
-			if (this->isLeftChild()) {
-				parent->left = nullptr;
-			} else if (this->isRightChild()) {
-				parent->right = nullptr;
-			}
-		}
-		delete left;
-		delete right;
 		delete data;
 	}
 
@@ -203,6 +203,7 @@ template<typename K, typename T>
 inline void RedBlackBST<K,T>::RotateLeft(Node* node)
 {
 	Node* pivot = node->right;
+	rotations++;
 
 	pivot->parent = node->parent; 
 	if (!node->isRoot()) 
@@ -229,6 +230,7 @@ template<typename K, typename T>
 inline void RedBlackBST<K,T>::RotateRight(Node* node)
 {
 	Node* pivot = node->left;
+	rotations++;
 
 	pivot->parent = node->parent; 
 	if (!node->isRoot())
@@ -276,6 +278,7 @@ inline void RedBlackBST<K,T>::Erase(const K& key)
 		if (target->isRoot()) {
 			root = nullptr;
 		} 
+		TreeNodes<Node>::Detach(target);
 		delete target;
 		return;
 	}
@@ -300,6 +303,7 @@ inline void RedBlackBST<K,T>::Erase(const K& key)
 			DeleteCase1(child);
 		}
 	}
+	TreeNodes<Node>::Detach(node);
 	delete node;
 }
 
@@ -309,6 +313,19 @@ inline RedBlackNode<K,T>* RedBlackBST<K,T>::Find(const K& key)
 	return Find(key, root);
 }
 
+template<typename K, typename T>
+inline void RedBlackBST<K,T>::Clear()
+{
+	TreeNodes<Node>::Clear(root);
+	root = nullptr;
+}
+
+template<typename K, typename T>
+inline unsigned int RedBlackBST<K,T>::Depth(const Node* node) const
+{
+	return TreeNodes<Node>::Depth(node);
+}
+
 template<typename K, typename T>
 inline void RedBlackBST<K,T>::InsertNode(Node* node, Node*& _root, Node* root_parent)
 {
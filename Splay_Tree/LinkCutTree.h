@@ -0,0 +1,275 @@
+//**************************************************************************************
+//								< Link-Cut Tree >
+//**************************************************************************************
+// Type:		Dynamic forest built on splay trees
+// Purpose:		Dynamic connectivity and path aggregates
+// Name:		Link-Cut tree (Sleator-Tarjan)
+// Implementation details:
+//		> Every preferred path is kept in an auxiliary splay tree ordered by depth.
+//		> The parent pointer of an auxiliary root is the path-parent pointer.
+//		> Rotations and splay steps come from SplayLinks, shared with SplayBST: an
+//		  auxiliary root hands its path-parent on instead of updating a tree root.
+//		> Evert (re-rooting) is lazy, through a reversal flag.
+//		> Combine must be associative and commutative.
+//		> All operations are O(log n) amortized.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include "SplayLinks.h"
+
+template<typename T, typename Combine = std::plus<T>>
+class LinkCutTree
+{
+public:
+	class Node;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<Node*> path;
+	Combine combine;
+
+public:
+	LinkCutTree(size_t size, const T& value = T(), Combine _combine = Combine())
+		: nodes(size, Node(value)), combine{ _combine }
+	{
+	}
+	LinkCutTree(const std::vector<T>& values, Combine _combine = Combine())
+		: nodes(values.begin(), values.end()), combine{ _combine }
+	{
+	}
+
+public:
+	LinkCutTree(const LinkCutTree& tree) = delete;
+	LinkCutTree& operator=(const LinkCutTree& tree) = delete;
+
+public:
+	void Link(size_t child, size_t parent);
+	void Cut(size_t first, size_t second);
+
+	size_t FindRoot(size_t node);
+	bool Connected(size_t first, size_t second)
+		{ return FindRoot(first) == FindRoot(second); }
+
+	void Evert(size_t node)
+		{ Evert(&nodes[node]); }
+	T PathAggregate(size_t first, size_t second);
+
+	const T& Value(size_t node) const
+		{ return nodes[node].value; }
+	void SetValue(size_t node, const T& value);
+
+	size_t Size() const
+		{ return nodes.size(); }
+
+private:
+	size_t Index(const Node* node) const
+		{ return node - nodes.data(); }
+
+	void Update(Node* node);
+	void PushDown(Node* node);
+
+	void Rotate(Node* parent, Node* child);
+	Node* Splay(Node* node);
+
+	Node* Access(Node* node);
+	void Evert(Node* node);
+};
+
+template<typename T, typename Combine>
+class LinkCutTree<T, Combine>::Node
+{
+	friend class LinkCutTree<T, Combine>;
+	friend struct SplayLinks<Node>;
+private:
+	T value;
+	T aggregate;
+	bool reversed = false;
+
+	Node* parent = nullptr;
+	Node* left = nullptr;
+	Node* right = nullptr;
+
+public:
+	Node(const T& _value)
+		: value{ _value }, aggregate{ _value }
+	{
+	}
+
+public:
+	// root of an auxiliary splay tree (its parent, if any, is a path-parent)
+	bool isRoot() const
+	{
+		return parent == nullptr || (parent->left != this && parent->right != this);
+	}
+	bool isLeftChild() const
+	{
+		return parent->left == this;
+	}
+	bool isRightChild() const
+	{
+		return parent->right == this;
+	}
+
+	const T& Value() const
+	{
+		return value;
+	}
+};
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::Update(Node* node)
+{
+	node->aggregate = node->value;
+	if (node->left) {
+		node->aggregate = combine(node->left->aggregate, node->aggregate);
+	}
+	if (node->right) {
+		node->aggregate = combine(node->aggregate, node->right->aggregate);
+	}
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::PushDown(Node* node)
+{
+	if (node->reversed)
+	{
+		std::swap(node->left, node->right);
+		if (node->left) {
+			node->left->reversed = !node->left->reversed;
+		}
+		if (node->right) {
+			node->right->reversed = !node->right->reversed;
+		}
+		node->reversed = false;
+	}
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::Rotate(Node* parent, Node* child)
+{
+	SplayLinks<Node>::Rotate(parent, child);
+	Update(parent);
+	Update(child);
+}
+
+template<typename T, typename Combine>
+inline typename LinkCutTree<T, Combine>::Node* LinkCutTree<T, Combine>::Splay(Node* node)
+{
+	// reversal flags are pushed from the auxiliary root down to node first
+	path.clear();
+	for (Node* current = node; ; current = current->parent)
+	{
+		path.push_back(current);
+		if (current->isRoot()) {
+			break;
+		}
+	}
+	for (auto iter = path.rbegin(); iter != path.rend(); iter++) {
+		PushDown(*iter);
+	}
+
+	while (!node->isRoot()) {
+		SplayLinks<Node>::Step(node, [this](Node* parent, Node* child) { Rotate(parent, child); });
+	}
+	return node;
+}
+
+template<typename T, typename Combine>
+inline typename LinkCutTree<T, Combine>::Node* LinkCutTree<T, Combine>::Access(Node* node)
+{
+	Node* last = nullptr;
+	for (Node* current = node; current != nullptr; current = current->parent)
+	{
+		Splay(current);
+		current->right = last;
+		Update(current);
+		last = current;
+	}
+	Splay(node);
+	return last;
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::Evert(Node* node)
+{
+	Access(node);
+	node->reversed = !node->reversed;
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::Link(size_t child, size_t parent)
+{
+	Node* childNode = &nodes[child];
+	Node* parentNode = &nodes[parent];
+
+	Evert(childNode);
+	if (FindRoot(parent) == child) {
+		throw std::runtime_error("Link failed: nodes are already connected.");
+	}
+	childNode->parent = parentNode;
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::Cut(size_t first, size_t second)
+{
+	Node* firstNode = &nodes[first];
+	Node* secondNode = &nodes[second];
+
+	Evert(firstNode);
+	Access(secondNode);
+	// after access the path is { first, second }, so first must be second's only left node
+	if (secondNode->left != firstNode || firstNode->right != nullptr) {
+		throw std::runtime_error("Cut failed: nodes are not adjacent.");
+	}
+	secondNode->left = nullptr;
+	firstNode->parent = nullptr;
+	Update(secondNode);
+}
+
+template<typename T, typename Combine>
+inline size_t LinkCutTree<T, Combine>::FindRoot(size_t node)
+{
+	Node* root = &nodes[node];
+	Access(root);
+	PushDown(root);
+	while (root->left != nullptr)
+	{
+		root = root->left;
+		PushDown(root);
+	}
+	Splay(root);
+	return Index(root);
+}
+
+template<typename T, typename Combine>
+inline T LinkCutTree<T, Combine>::PathAggregate(size_t first, size_t second)
+{
+	if (!Connected(first, second)) {
+		throw std::runtime_error("Path aggregate failed: nodes are not connected.");
+	}
+	Evert(&nodes[first]);
+	Access(&nodes[second]);
+	return nodes[second].aggregate;
+}
+
+template<typename T, typename Combine>
+inline void LinkCutTree<T, Combine>::SetValue(size_t node, const T& value)
+{
+	Node* target = &nodes[node];
+	Access(target);
+	target->value = value;
+	Update(target);
+}
+
+// Usage example
+//LinkCutTree<int> forest(5, 1);
+//forest.Link(1, 0);
+//forest.Link(2, 1);
+//forest.Connected(0, 2);			// true
+//forest.PathAggregate(0, 2);		// 3
+//forest.Cut(1, 2);
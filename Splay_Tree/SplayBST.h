@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <utility>
+#include <stdexcept>
+#include "SplayLinks.h"
+#include "../Binary_Tree_Nodes/TreeNodes.h"
 
 template<typename K, typename T>
 class SplayBST
@@ -10,12 +14,13 @@ public:
 
 private:
 	Node* m_root	= nullptr;
+	size_t m_rotations	= 0;
 
 public:
 	SplayBST()
 		{	}
 	~SplayBST()
-		{ delete m_root; }
+		{ Clear(); }
 
 public:
 	SplayBST(const SplayBST& tree) = delete;
@@ -27,10 +32,15 @@ public:
 		{ Erase(m_root, key); }
 
 	Node* Find(const K& key);
+	void Clear();
 
 	Node* Root()
 		{ return m_root; }
 
+	unsigned int Depth(const Node* node) const;
+	size_t Rotations() const
+		{ return m_rotations; }
+
 	template<typename Func>
 	void InOrder(Node* _root, Func func);
 
@@ -65,6 +75,8 @@ template<typename K, typename T>
 class SplayBST<K, T>::Node
 {
 	friend class SplayBST<K, T>;
+	friend struct TreeNodes<Node>;
+	friend struct SplayLinks<Node>;
 private:
 	K key;
 	T* data = nullptr;
@@ -84,17 +96,6 @@ public:
 	}
 	~Node()
 	{
-		if (parent)
-		{
-			if (this->isLeftChild()) {
-				parent->left = nullptr;
-			}
-			else if (this->isRightChild()) {
-				parent->right = nullptr;
-			}
-		}
-		delete left;
-		delete right;
 		delete data;
 	}
 
@@ -166,6 +167,19 @@ inline void SplayBST<K,T>::InOrder(Node* _root, Func func)
 	}
 }
 
+template<typename K, typename T>
+inline void SplayBST<K,T>::Clear()
+{
+	TreeNodes<Node>::Clear(m_root);
+	m_root = nullptr;
+}
+
+template<typename K, typename T>
+inline unsigned int SplayBST<K,T>::Depth(const Node* node) const
+{
+	return TreeNodes<Node>::Depth(node);
+}
+
 template<typename K, typename T>
 inline void SplayBST<K,T>::Insert(const K& key, const T& data)
 {
@@ -185,82 +199,32 @@ inline SplayNode<K,T>* SplayBST<K,T>::Find(const K& key)
 template<typename K, typename T>
 inline void SplayBST<K,T>::SetParent(Node* child, Node* parent)
 {
-	if (child != nullptr) {
-		child->parent = parent;
-	}
+	SplayLinks<Node>::SetParent(child, parent);
 }
 
 template<typename K, typename T>
 inline void SplayBST<K,T>::KeepParent(Node* node)
 {
-	SetParent(node->left, node);
-	SetParent(node->right, node);
+	SplayLinks<Node>::KeepParent(node);
 }
 
 template<typename K, typename T>
 inline void SplayBST<K,T>::Rotate(Node* parent, Node* child)
 {
-	Node* grand_parent = parent->parent;
-
-	if (grand_parent != nullptr)
-	{
-		if (parent->isLeftChild()) {
-			grand_parent->left = child;
-		}
-		else {
-			grand_parent->right = child;
-		}
-	}
-	else {
+	if (parent->isRoot()) {
 		m_root = child;
 	}
-
-	if (child->isLeftChild())
-	{
-		parent->left = child->right;
-		child->right = parent;
-	}
-	else
-	{
-		parent->right = child->left;
-		child->left = parent;
-	}
-
-	KeepParent(child);
-	KeepParent(parent);
-
-	child->parent = grand_parent;
+	m_rotations++;
+	SplayLinks<Node>::Rotate(parent, child);
 }
 
 template<typename K, typename T>
 inline SplayNode<K,T>* SplayBST<K,T>::Splay(Node* node)
 {
-	if (node->parent == nullptr) {
-		return node;
-	}
-	Node* parent = node->parent;
-	Node* grand_parent = parent->parent;
-
-	if (grand_parent == nullptr)
-	{
-		Rotate(parent, node);
-		return node;
-	}
-	else
-	{
-		bool zigzig = (parent->isLeftChild() == node->isLeftChild());
-		if (zigzig)
-		{
-			Rotate(grand_parent, parent);
-			Rotate(parent, node);
-		}
-		else	// zig-zag
-		{
-			Rotate(parent, node);
-			Rotate(grand_parent, node);
-		}
+	while (!node->isRoot()) {
+		SplayLinks<Node>::Step(node, [this](Node* parent, Node* child) { Rotate(parent, child); });
 	}
-	return Splay(node);
+	return node;
 }
 
 template<typename K, typename T>
@@ -334,8 +298,6 @@ inline void SplayBST<K,T>::Erase(Node* root, const K& key)
 	if (root == m_root) {
 		m_root = result;
 	}
-	root->left = nullptr;
-	root->right = nullptr;
 	delete root;
 }
 
@@ -0,0 +1,304 @@
+//**************************************************************************************
+//								< Splay Cache >
+//**************************************************************************************
+// Type:		Bounded self-adjusting Binary-Search tree
+// Purpose:		Recency-biased key-value cache
+// Name:		Splay cache
+// Implementation details:
+//		> Splay tree over a fixed arena of Capacity() nodes, allocated once.
+//		> Evicted and erased nodes are recycled, so a full cache never allocates.
+//		> Eviction uses a CLOCK sweep over the arena: a hit or an insertion sets
+//		  the node's reference bit, the sweep clears bits until it finds a node
+//		  that was not touched since the previous pass.
+//
+//**************************************************************************************
+
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+#include "SplayLinks.h"
+
+template<typename K, typename T>
+class SplayCache
+{
+public:
+	class Node;
+
+private:
+	std::vector<Node> nodes;
+	Node* m_root	= nullptr;
+	Node* m_free	= nullptr;	// erased or evicted nodes, chained through right
+	size_t hand		= 0;		// CLOCK hand, index into nodes
+	size_t size		= 0;
+	size_t capacity;			// as requested, nodes may have reserved more
+
+	size_t hits		= 0;
+	size_t misses	= 0;
+
+public:
+	explicit SplayCache(size_t _capacity)
+		: capacity{ _capacity }
+	{
+		if (capacity == 0) {
+			throw std::runtime_error("SplayCache construction error: capacity must be positive.");
+		}
+		nodes.reserve(capacity);
+	}
+
+public:
+	SplayCache(const SplayCache& cache) = delete;
+	SplayCache& operator=(const SplayCache& cache) = delete;
+
+public:
+	Node* Find(const K& key);
+	void Insert(const K& key, const T& data);
+	bool Erase(const K& key);
+
+	size_t Size()		const { return size; }
+	size_t Capacity()	const { return capacity; }
+	size_t Hits()		const { return hits; }
+	size_t Misses()		const { return misses; }
+	void ResetCounters()
+		{ hits = misses = 0; }
+
+private:
+	void SetParent(Node* child, Node* parent);
+	void KeepParent(Node* node);
+	void Rotate(Node* parent, Node* child);
+	Node* Splay(Node* node);
+
+	Node* Search(const K& key);
+	Node* Acquire(const K& key, const T& data);
+	void Release(Node* node);
+	void Evict();
+	void Remove(Node* node);
+};
+
+template<typename K, typename T>
+class SplayCache<K, T>::Node
+{
+	friend class SplayCache<K, T>;
+	friend struct SplayLinks<Node>;
+private:
+	K key;
+	T data;
+	bool referenced = true;
+
+	Node* parent = nullptr;
+	Node* left = nullptr;
+	Node* right = nullptr;
+
+public:
+	Node(const K& _key, const T& _data)
+		: key{ _key }, data{ _data }
+	{
+	}
+
+public:
+	bool isRoot() const
+	{
+		return parent == nullptr;
+	}
+	bool isLeftChild() const
+	{
+		return parent->left == this;
+	}
+
+	const K& Key() const
+	{
+		return key;
+	}
+	T& Data()
+	{
+		return data;
+	}
+};
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::SetParent(Node* child, Node* parent)
+{
+	SplayLinks<Node>::SetParent(child, parent);
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::KeepParent(Node* node)
+{
+	SplayLinks<Node>::KeepParent(node);
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::Rotate(Node* parent, Node* child)
+{
+	if (parent->isRoot()) {
+		m_root = child;
+	}
+	SplayLinks<Node>::Rotate(parent, child);
+}
+
+template<typename K, typename T>
+inline typename SplayCache<K, T>::Node* SplayCache<K, T>::Splay(Node* node)
+{
+	while (!node->isRoot()) {
+		SplayLinks<Node>::Step(node, [this](Node* parent, Node* child) { Rotate(parent, child); });
+	}
+	return node;
+}
+
+// Splays the node holding key, or the last node on the search path, to the root.
+template<typename K, typename T>
+inline typename SplayCache<K, T>::Node* SplayCache<K, T>::Search(const K& key)
+{
+	Node* node = m_root;
+	if (node == nullptr) {
+		return nullptr;
+	}
+	while (node->key != key)
+	{
+		Node* next = (key < node->key) ? node->left : node->right;
+		if (next == nullptr) {
+			break;
+		}
+		node = next;
+	}
+	return Splay(node);
+}
+
+template<typename K, typename T>
+inline typename SplayCache<K, T>::Node* SplayCache<K, T>::Find(const K& key)
+{
+	Node* node = Search(key);
+	if (node && node->key == key)
+	{
+		node->referenced = true;
+		hits++;
+		return node;
+	}
+	misses++;
+	return nullptr;
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::Insert(const K& key, const T& data)
+{
+	Node* root = Search(key);
+	if (root && root->key == key)
+	{
+		root->data = data;
+		root->referenced = true;
+		return;
+	}
+
+	if (size == Capacity())
+	{
+		Evict();
+		// eviction restructured the tree, bring the neighbour of key back up
+		root = Search(key);
+	}
+	Node* node = Acquire(key, data);
+
+	if (root != nullptr)
+	{
+		if (root->key < key)
+		{
+			node->left = root;
+			node->right = root->right;
+			root->right = nullptr;
+		}
+		else
+		{
+			node->right = root;
+			node->left = root->left;
+			root->left = nullptr;
+		}
+	}
+	KeepParent(node);
+	m_root = node;
+	size++;
+}
+
+template<typename K, typename T>
+inline bool SplayCache<K, T>::Erase(const K& key)
+{
+	Node* node = Search(key);
+	if (!node || node->key != key) {
+		return false;
+	}
+	Release(node);
+	return true;
+}
+
+// Takes a detached node for key: a recycled one, or a fresh arena slot.
+template<typename K, typename T>
+inline typename SplayCache<K, T>::Node* SplayCache<K, T>::Acquire(const K& key, const T& data)
+{
+	if (m_free == nullptr)
+	{
+		nodes.emplace_back(key, data);
+		return &nodes.back();
+	}
+	Node* node = m_free;
+	m_free = node->right;
+	node->key = key;
+	node->data = data;
+	node->referenced = true;
+	node->parent = node->left = node->right = nullptr;
+	return node;
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::Release(Node* node)
+{
+	Remove(node);
+	node->right = m_free;
+	m_free = node;
+	size--;
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::Evict()
+{
+	// every slot is live here, so the sweep ends within two passes
+	while (nodes[hand].referenced)
+	{
+		nodes[hand].referenced = false;
+		hand = (hand + 1) % nodes.size();
+	}
+	Node* victim = &nodes[hand];
+	hand = (hand + 1) % nodes.size();
+	Release(victim);
+}
+
+template<typename K, typename T>
+inline void SplayCache<K, T>::Remove(Node* node)
+{
+	Splay(node);
+	Node* left = node->left;
+	Node* right = node->right;
+	SetParent(left, nullptr);
+	SetParent(right, nullptr);
+
+	if (left == nullptr) {
+		m_root = right;
+	}
+	else
+	{
+		// the maximum of the left subtree has no right child after splaying
+		Node* max = left;
+		while (max->right != nullptr) {
+			max = max->right;
+		}
+		Splay(max);
+		max->right = right;
+		SetParent(right, max);
+		m_root = max;
+	}
+	node->parent = node->left = node->right = nullptr;
+}
+
+// Usage example
+//SplayCache<int, std::string> cache(1024);
+//cache.Insert(42, "answer");
+//if (auto node = cache.Find(42)) {
+//	std::cout << node->Data();
+//}
@@ -0,0 +1,91 @@
+//**************************************************************************************
+//								< Splay Links >
+//**************************************************************************************
+// Type:		Splay tree building block
+// Purpose:		Rotation and splay step shared by SplayBST, SplayCache and LinkCutTree
+// Name:		Splay links
+// Implementation details:
+//		> Node needs parent, left and right pointers and isRoot() / isLeftChild(),
+//		  and has to befriend SplayLinks<Node>.
+//		> Only the pointers are rewired here. The owner updates its root pointer,
+//		  counters or aggregates around each rotation.
+//		> A node is a root if isRoot() says so, which lets LinkCutTree keep a
+//		  path-parent in the parent pointer of an auxiliary root: a rotation at the
+//		  root passes the parent pointer on to the lifted child unchanged.
+//
+//**************************************************************************************
+
+#pragma once
+
+template<typename Node>
+struct SplayLinks
+{
+	static void SetParent(Node* child, Node* parent)
+	{
+		if (child != nullptr) {
+			child->parent = parent;
+		}
+	}
+	static void KeepParent(Node* node)
+	{
+		SetParent(node->left, node);
+		SetParent(node->right, node);
+	}
+
+	// Lifts child above parent.
+	static void Rotate(Node* parent, Node* child)
+	{
+		Node* grand_parent = parent->parent;
+
+		if (!parent->isRoot())
+		{
+			if (parent->isLeftChild()) {
+				grand_parent->left = child;
+			}
+			else {
+				grand_parent->right = child;
+			}
+		}
+
+		if (child->isLeftChild())
+		{
+			parent->left = child->right;
+			child->right = parent;
+		}
+		else
+		{
+			parent->right = child->left;
+			child->left = parent;
+		}
+
+		KeepParent(child);
+		KeepParent(parent);
+
+		child->parent = grand_parent;
+	}
+
+	// One zig, zig-zig or zig-zag step lifting a non-root node, rotate(parent, child)
+	// performs the rotations.
+	template<typename Rotation>
+	static void Step(Node* node, Rotation rotate)
+	{
+		Node* parent = node->parent;
+		if (parent->isRoot())
+		{
+			rotate(parent, node);
+			return;
+		}
+		Node* grand_parent = parent->parent;
+		bool zigzig = (parent->isLeftChild() == node->isLeftChild());
+		if (zigzig)
+		{
+			rotate(grand_parent, parent);
+			rotate(parent, node);
+		}
+		else	// zig-zag
+		{
+			rotate(parent, node);
+			rotate(grand_parent, node);
+		}
+	}
+};